@@ -11,6 +11,9 @@ target_include_directories(${LIB_NAME}
 )
 include(FindPkgConfig)
 
+# Native thread extensions: affinity, os priority and topology-aware placement for thread_pool
+target_compile_definitions(${LIB_NAME} PUBLIC XH_THREAD_POOL_NATIVE_EXTENTIONS)
+
 target_link_libraries(${LIB_NAME} PRIVATE fmt::fmt)
 target_link_libraries(${LIB_NAME} PRIVATE event)
 
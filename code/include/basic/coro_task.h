@@ -0,0 +1,634 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <semaphore>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace XH {
+
+// Thread-local freelists of coroutine frames, one per 64 byte size class up to 1KB, so a pipeline
+// that keeps spawning the same coroutines stops touching the global heap once warmed up.
+// Frames are often created on one thread and destroyed on a worker, so full lists spill batches
+// into a shared depot and empty ones refill from it, one lock round-trip per batch.
+class frame_pool
+{
+public:
+    [[nodiscard]] static void* allocate(const std::size_t size)
+    {
+        const std::size_t cls = size_class(size);
+        if (cls >= classes)
+            return ::operator new(size);
+
+        cache& local = local_cache();
+        if (local.heads[cls] == nullptr)
+            refill(local, cls);
+        if (free_node* node = local.heads[cls])
+        {
+            local.heads[cls] = node->next;
+            --local.counts[cls];
+            return node;
+        }
+        return ::operator new((cls + 1) * granularity);
+    }
+
+    static void deallocate(void* ptr, const std::size_t size) noexcept
+    {
+        const std::size_t cls = size_class(size);
+        if (cls >= classes)
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        cache& local = local_cache();
+        local.heads[cls] = ::new (ptr) free_node{local.heads[cls]};
+        if (++local.counts[cls] == max_cached)
+            spill(local, cls);
+    }
+
+private:
+    static constexpr std::size_t granularity = 64;
+    static constexpr std::size_t classes = 16;
+    // Per class and thread; reaching it moves one batch to the depot.
+    static constexpr std::size_t max_cached = 256;
+    static constexpr std::size_t batch_size = max_cached / 2;
+    // Per class; batches beyond it go back to the heap.
+    static constexpr std::size_t max_depot_batches = 64;
+
+    struct free_node
+    {
+        free_node* next;
+    };
+
+    static void free_list(free_node* head) noexcept
+    {
+        while (head != nullptr)
+            ::operator delete(std::exchange(head, head->next));
+    }
+
+    struct cache
+    {
+        ~cache()
+        {
+            for (free_node* head : heads)
+                free_list(head);
+        }
+
+        std::array<free_node*, classes> heads = {};
+        std::array<std::size_t, classes> counts = {};
+    };
+
+    // Batches of batch_size nodes each, handed between threads.
+    struct depot
+    {
+        ~depot()
+        {
+            for (std::vector<free_node*>& cls_batches : batches)
+            {
+                for (free_node* batch : cls_batches)
+                    free_list(batch);
+            }
+        }
+
+        std::mutex mutex;
+        std::array<std::vector<free_node*>, classes> batches;
+    };
+
+    [[nodiscard]] static constexpr std::size_t size_class(const std::size_t size) noexcept
+    {
+        return size == 0 ? 0 : (size - 1) / granularity;
+    }
+
+    [[nodiscard]] static cache& local_cache() noexcept
+    {
+        thread_local cache local;
+        return local;
+    }
+
+    [[nodiscard]] static depot& shared_depot() noexcept
+    {
+        static depot shared;
+        return shared;
+    }
+
+    static void refill(cache& local, const std::size_t cls)
+    {
+        depot& shared = shared_depot();
+        const std::scoped_lock lock(shared.mutex);
+        if (shared.batches[cls].empty())
+            return;
+        local.heads[cls] = shared.batches[cls].back();
+        local.counts[cls] = batch_size;
+        shared.batches[cls].pop_back();
+    }
+
+    static void spill(cache& local, const std::size_t cls) noexcept
+    {
+        free_node* batch = local.heads[cls];
+        free_node* last = batch;
+        for (std::size_t i = 1; i < batch_size; ++i)
+            last = last->next;
+        local.heads[cls] = std::exchange(last->next, nullptr);
+        local.counts[cls] -= batch_size;
+
+        depot& shared = shared_depot();
+        {
+            const std::scoped_lock lock(shared.mutex);
+            if (shared.batches[cls].size() < max_depot_batches)
+            {
+#ifdef __cpp_exceptions
+                try
+                {
+#endif
+                    shared.batches[cls].push_back(batch);
+                    return;
+#ifdef __cpp_exceptions
+                }
+                catch (...)
+                {
+                }
+#endif
+            }
+        }
+        free_list(batch);
+    }
+};
+
+// Promise types derive from this to get their frames from frame_pool.
+struct pooled_frame
+{
+    [[nodiscard]] static void* operator new(const std::size_t size)
+    {
+        return frame_pool::allocate(size);
+    }
+
+    static void operator delete(void* ptr, const std::size_t size) noexcept
+    {
+        frame_pool::deallocate(ptr, size);
+    }
+};
+
+template <typename T = void>
+class task;
+
+namespace detail {
+template <typename T>
+using non_void_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+// Hands control straight to whoever awaited the task (symmetric transfer), so a chain of
+// co_awaits continues on the same thread without growing the stack.
+struct task_final_awaiter
+{
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <typename P>
+    std::coroutine_handle<> await_suspend(const std::coroutine_handle<P> finished) noexcept
+    {
+        const std::coroutine_handle<> continuation = finished.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct task_promise_base : pooled_frame
+{
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    task_final_awaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation = nullptr;
+    std::exception_ptr error = nullptr;
+};
+
+template <typename T>
+struct task_promise : task_promise_base
+{
+    task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& result)
+    {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T take()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+    std::optional<T> value = std::nullopt;
+};
+
+template <>
+struct task_promise<void> : task_promise_base
+{
+    task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void take() const
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+} // namespace detail
+
+// Lazily started coroutine producing a T. Nothing runs until the task is co_awaited (or passed
+// to sync_wait / when_all / when_any); the awaiting coroutine resumes on whichever thread the
+// task finishes on. Use co_await pool.schedule() inside to move onto a thread_pool.
+template <typename T>
+class [[nodiscard]] task
+{
+public:
+    using promise_type = detail::task_promise<T>;
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    task() = default;
+
+    explicit task(const handle_t handle) noexcept : m_handle(handle) {}
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    task(task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~task()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    [[nodiscard]] bool done() const noexcept
+    {
+        return m_handle && m_handle.done();
+    }
+
+    // Runs the task and yields its result, rethrowing whatever it threw.
+    auto operator co_await() noexcept
+    {
+        struct awaiter : starter
+        {
+            T await_resume()
+            {
+                return this->handle.promise().take();
+            }
+        };
+        return awaiter{{m_handle}};
+    }
+
+    // Runs the task without fetching its result, take_result() gets it afterwards.
+    auto ready() noexcept
+    {
+        struct awaiter : starter
+        {
+            void await_resume() const noexcept {}
+        };
+        return awaiter{{m_handle}};
+    }
+
+    // Only valid once the task is done.
+    T take_result()
+    {
+        assert(done());
+        return m_handle.promise().take();
+    }
+
+private:
+    struct starter
+    {
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        handle_t handle;
+    };
+
+    handle_t m_handle = nullptr;
+};
+
+namespace detail {
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+// Eagerly started, self-destroying coroutine used to drive tasks from the combinators.
+struct detached_task
+{
+    struct promise_type : pooled_frame
+    {
+        detached_task get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+// Started by sync_wait, signals the blocked caller once it reached its final suspend point.
+struct sync_wait_task
+{
+    struct promise_type : pooled_frame
+    {
+        sync_wait_task get_return_object() noexcept
+        {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() const noexcept
+        {
+            struct awaiter
+            {
+                [[nodiscard]] bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                void await_suspend(const std::coroutine_handle<promise_type> finished) const noexcept
+                {
+                    finished.promise().done->release();
+                }
+
+                void await_resume() const noexcept {}
+            };
+            return awaiter{};
+        }
+
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+
+        std::binary_semaphore* done = nullptr;
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+sync_wait_task run_sync_wait(task<T>& awaited)
+{
+    co_await awaited.ready();
+}
+
+// Counts the tasks of a when_all plus the starter itself, the last one in resumes the awaiter.
+struct when_all_latch
+{
+    explicit when_all_latch(const std::size_t count) : remaining(count + 1) {}
+
+    [[nodiscard]] bool arrive() noexcept
+    {
+        return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    std::atomic<std::size_t> remaining;
+    std::coroutine_handle<> continuation = nullptr;
+};
+
+template <typename T>
+detached_task run_when_all_item(task<T>& awaited, when_all_latch& latch)
+{
+    co_await awaited.ready();
+    if (latch.arrive())
+        latch.continuation.resume();
+}
+
+template <typename Start>
+struct when_all_awaiter
+{
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    // If every task finished before the starter arrives, don't suspend at all.
+    bool await_suspend(const std::coroutine_handle<> awaiting) noexcept
+    {
+        latch.continuation = awaiting;
+        start(latch);
+        return !latch.arrive();
+    }
+
+    void await_resume() const noexcept {}
+
+    when_all_latch latch;
+    Start start;
+};
+
+// @start(latch) must launch run_when_all_item for each of the @count tasks.
+template <typename Start>
+when_all_awaiter<Start> wait_all(const std::size_t count, Start start)
+{
+    return {when_all_latch(count), std::move(start)};
+}
+
+template <typename T>
+non_void_t<T> take_non_void(task<T>& finished)
+{
+    if constexpr (std::is_void_v<T>)
+    {
+        finished.take_result();
+        return {};
+    }
+    else
+    {
+        return finished.take_result();
+    }
+}
+
+template <typename T>
+struct when_any_state
+{
+    std::atomic<bool> decided = false;
+    // The first finisher and the starter both arrive, whoever comes second resumes the awaiter.
+    std::atomic<int> arrivals = 2;
+    std::coroutine_handle<> continuation = nullptr;
+    std::size_t index = 0;
+    task<T> winner;
+};
+
+// Owns its task, so the losers of a when_any can run to completion after the awaiter moved on.
+template <typename T>
+detached_task run_when_any_item(task<T> awaited, const std::size_t index, std::shared_ptr<when_any_state<T>> state)
+{
+    co_await awaited.ready();
+    if (state->decided.exchange(true, std::memory_order_acq_rel))
+        co_return;
+    state->index = index;
+    state->winner = std::move(awaited);
+    if (state->arrivals.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        state->continuation.resume();
+}
+
+template <typename T>
+struct when_any_awaiter
+{
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(const std::coroutine_handle<> awaiting)
+    {
+        state->continuation = awaiting;
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+            run_when_any_item(std::move(tasks[i]), i, state);
+        return state->arrivals.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    void await_resume() const noexcept {}
+
+    // Only references: GCC 12 may destroy a co_await operand temporary twice, which must not
+    // release anything. The awaiting coroutine keeps both alive.
+    const std::shared_ptr<when_any_state<T>>& state;
+    std::vector<task<T>>& tasks;
+};
+} // namespace detail
+
+// Runs @awaited to completion on the calling thread, blocking while it is suspended elsewhere.
+template <typename T>
+T sync_wait(task<T> awaited)
+{
+    std::binary_semaphore done{0};
+    const detail::sync_wait_task waiter = detail::run_sync_wait(awaited);
+    waiter.handle.promise().done = &done;
+    waiter.handle.resume();
+    done.acquire();
+    waiter.handle.destroy();
+    return awaited.take_result();
+}
+
+// Starts all tasks at once and completes when every one of them did. Results keep the order of
+// the input; if any task threw, the first such exception (in input order) is rethrown.
+template <typename T>
+task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<task<T>> tasks)
+{
+    co_await detail::wait_all(tasks.size(),
+        [&tasks](detail::when_all_latch& latch)
+        {
+            for (task<T>& awaited : tasks)
+                detail::run_when_all_item(awaited, latch);
+        });
+    if constexpr (std::is_void_v<T>)
+    {
+        for (task<T>& finished : tasks)
+            finished.take_result();
+    }
+    else
+    {
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (task<T>& finished : tasks)
+            results.push_back(finished.take_result());
+        co_return results;
+    }
+}
+
+// Heterogeneous form, void results show up as std::monostate.
+template <typename... Ts>
+task<std::tuple<detail::non_void_t<Ts>...>> when_all(task<Ts>... tasks)
+{
+    co_await detail::wait_all(sizeof...(Ts),
+        [&](detail::when_all_latch& latch)
+        {
+            (detail::run_when_all_item(tasks, latch), ...);
+        });
+    co_return std::tuple<detail::non_void_t<Ts>...>{detail::take_non_void(tasks)...};
+}
+
+template <typename T>
+struct when_any_result
+{
+    std::size_t index;
+    detail::non_void_t<T> value;
+};
+
+// Starts all tasks at once and completes with the first one to finish. The others keep running
+// in the background and their results are dropped, so they must not reference anything the
+// caller is about to destroy. @tasks must not be empty.
+template <typename T>
+task<when_any_result<T>> when_any(std::vector<task<T>> tasks)
+{
+    assert(!tasks.empty());
+    std::shared_ptr<detail::when_any_state<T>> state = std::make_shared<detail::when_any_state<T>>();
+    co_await detail::when_any_awaiter<T>{state, tasks};
+    co_return when_any_result<T>{state->index, detail::take_non_void(state->winner)};
+}
+} // namespace XH
@@ -0,0 +1,139 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace XH {
+
+// Move-only `void()` callable with N bytes of inline storage.
+// Callables that fit (and are nothrow movable) live inside the object, so submitting a typical
+// lambda never touches the heap. Bigger ones fall back to a single heap allocation.
+// Unlike std::function it accepts move-only captures (promises, unique_ptrs, ...).
+template <std::size_t N>
+class inplace_task
+{
+    template <typename F>
+    static constexpr bool fits_inline = sizeof(F) <= N && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+
+public:
+    static constexpr std::size_t inline_size = N;
+
+    inplace_task() noexcept = default;
+
+    inplace_task(std::nullptr_t) noexcept {}
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, inplace_task> && std::is_invocable_v<std::decay_t<F>&>>>
+    inplace_task(F&& func)
+    {
+        using callable_t = std::decay_t<F>;
+        if constexpr (fits_inline<callable_t>)
+        {
+            ::new (static_cast<void*>(m_storage)) callable_t(std::forward<F>(func));
+            m_ops = &inline_ops<callable_t>;
+        }
+        else
+        {
+            ::new (static_cast<void*>(m_storage)) callable_t*(new callable_t(std::forward<F>(func)));
+            m_ops = &heap_ops<callable_t>;
+        }
+    }
+
+    inplace_task(inplace_task&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    inplace_task& operator=(inplace_task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    inplace_task(const inplace_task&) = delete;
+    inplace_task& operator=(const inplace_task&) = delete;
+
+    ~inplace_task()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        assert(m_ops != nullptr);
+        m_ops->invoke(m_storage);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_ops != nullptr;
+    }
+
+    // True when the callable lives in the inline buffer, i.e. construction did not allocate.
+    [[nodiscard]] bool is_inline() const noexcept
+    {
+        return m_ops != nullptr && m_ops->is_inline;
+    }
+
+    void reset() noexcept
+    {
+        if (m_ops != nullptr)
+        {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    struct ops_t
+    {
+        void (*invoke)(void* storage);
+        // Move-constructs into dst and destroys src.
+        void (*relocate)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+        bool is_inline;
+    };
+
+    template <typename F>
+    static constexpr ops_t inline_ops = {
+        [](void* storage) { (*std::launder(static_cast<F*>(storage)))(); },
+        [](void* dst, void* src) noexcept
+        {
+            F* from = std::launder(static_cast<F*>(src));
+            ::new (dst) F(std::move(*from));
+            from->~F();
+        },
+        [](void* storage) noexcept { std::launder(static_cast<F*>(storage))->~F(); },
+        true,
+    };
+
+    template <typename F>
+    static constexpr ops_t heap_ops = {
+        [](void* storage) { (**std::launder(static_cast<F**>(storage)))(); },
+        [](void* dst, void* src) noexcept { ::new (dst) F*(*std::launder(static_cast<F**>(src))); },
+        [](void* storage) noexcept { delete *std::launder(static_cast<F**>(storage)); },
+        false,
+    };
+
+    void move_from(inplace_task& other) noexcept
+    {
+        if (other.m_ops != nullptr)
+        {
+            other.m_ops->relocate(m_storage, other.m_storage);
+            m_ops = std::exchange(other.m_ops, nullptr);
+        }
+    }
+
+    static_assert(N >= sizeof(void*), "inplace_task needs room for at least a pointer");
+
+    alignas(std::max_align_t) std::byte m_storage[N];
+    const ops_t* m_ops = nullptr;
+};
+} // namespace XH
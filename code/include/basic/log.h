@@ -1,51 +1,207 @@
 #ifndef LOG_H
 #define LOG_H
 #include <stdint.h>
-#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
 #include "fmt/format-inl.h"
 #include "fmt/chrono.h"
+#include "event_count.h"
 #include "thread_safe_queue.h"
+#include "basic/log_format.h"
+#include "basic/log_mmap.h"
+#include "basic/log_ring.h"
 
-#define LOG_DEBUG(fmt, ...)                                 \
-    {                                                       \
-        Log::GetInstance().WriteLog(0, fmt, ##__VA_ARGS__); \
-    }
-#define LOG_INFO(fmt, ...)                                  \
-    {                                                       \
-        Log::GetInstance().WriteLog(1, fmt, ##__VA_ARGS__); \
-    }
-#define LOG_WARN(fmt, ...)                                  \
-    {                                                       \
-        Log::GetInstance().WriteLog(2, fmt, ##__VA_ARGS__); \
-    }
-#define LOG_ERROR(fmt, ...)                                 \
-    {                                                       \
-        Log::GetInstance().WriteLog(3, fmt, ##__VA_ARGS__); \
-    }
+// 编译期最低等级（0-DEBUG 1-INFO 2-WARN 3-ERROR 4-全关），低于它的语句连同参数一起被预处理掉
+#ifndef XH_LOG_MIN_LEVEL
+#define XH_LOG_MIN_LEVEL 0
+#endif
+
+// 运行期先做一次内联的等级判断，不满足时参数不会被求值。
+// 格式串经fmt::format_string在编译期校验；每个调用点第一次执行时登记格式串，
+// 之后只记录格式id和参数，格式化交给后台线程
+#define LOG_WRITE(level, fmt, ...)                                                       \
+    do {                                                                                 \
+        if (Log::Enabled(level)) {                                                       \
+            static const uint32_t xhLogFormatId = Log::RegisterFormat(level, fmt);       \
+            Log::GetInstance().WriteFormat(level, xhLogFormatId, fmt, ##__VA_ARGS__);    \
+        }                                                                                \
+    } while (0)
+#define LOG_DISABLED(fmt, ...) \
+    do {                       \
+    } while (0)
+
+#if XH_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(fmt, ...) LOG_WRITE(0, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+#if XH_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(fmt, ...) LOG_WRITE(1, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+#if XH_LOG_MIN_LEVEL <= 2
+#define LOG_WARN(fmt, ...) LOG_WRITE(2, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+#if XH_LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(fmt, ...) LOG_WRITE(3, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
 
 constexpr char LOG_LEVEL[4] = {'D', 'I', 'W', 'E'};
 
+class LogSink;
+class LogSinkWorker;
+struct LogBatch;
+
+enum class LogMode {
+    Text,    // 后台线程格式化成文本
+    Binary,  // 原样写二进制记录，用LogCodec::Decode(tools/log_decode)转成文本
+};
+
+enum class LogOutput {
+    Write,  // 每批一次write
+    Mmap,   // 预分配并映射文件，写线程直接memcpy，见LogMmapFile
+};
+
+// 日志文件切换策略，除了跨天总会切换外，满足任一条件也切换
+struct LogRotation {
+    // 当前文件超过这么多字节就切换，0-不限
+    uint64_t maxBytes = 0;
+    // 当前文件打开超过这么久就切换，0-不限
+    std::chrono::seconds interval{0};
+    // 最多保留多少个切换下来的文件（含压缩后的），0-全部保留
+    size_t keep = 0;
+    // 切换下来的文件交给它压缩（比如调gzip/zstd，压完删掉原文件），在低优先级线程上执行，空-不压缩
+    std::function<void(const std::filesystem::path&)> compress;
+};
+
 class Log {
 public:
     // ensure Init func has been called
     static Log &GetInstance();
-    bool Init(std::string_view fullpath, uint32_t queueSize, int levelMask);
+    // 打开日志文件并启动后台写线程。
+    // 每个写日志的线程有自己的环形缓冲区，WriteLog只在本线程格式化并拷进去，不加锁不分配内存；
+    // 后台线程轮询所有线程的缓冲区，按时间戳归并后写文件。
+    // @queueSize: 后台线程每批最多取这么多条，合并成一次write
+    // @capacity: 每个线程缓冲区的字节数，对之后第一次写日志的线程生效
+    // @policy: 缓冲区满时Block-等后台线程腾出空间，DropNewest-丢弃新日志并计入Dropped()。
+    //          缓冲区只有写线程往里写、后台线程从头取，没法从队头丢老日志，Fail/DropOldest都按DropNewest处理
+    // @mode: Binary时文件名多一个.bin后缀
+    bool Init(std::string_view fullpath, uint32_t queueSize, int levelMask,
+              size_t capacity = RING_BYTES, OverflowPolicy policy = OverflowPolicy::DropNewest,
+              LogMode mode = LogMode::Text);
+
+    // 文本日志里时间戳的精度，默认到分钟
+    void SetTimePrecision(LogTimePrecision precision);
+
+    // 按大小/时间切换文件。当天切换下来的文件改名为<name>_<date>.<n>，n从1递增
+    void SetRotation(LogRotation rotation);
+
+    // 写文件的方式，已经打开的文件会重新打开
+    // @window: Mmap时每次映射的字节数
+    void SetOutput(LogOutput output, size_t window = LogMmapFile::WINDOW);
+
+    // 同一份日志再以文本输出到sink（见basic/log_sink.h），等级和文件的levelMask各管各的
+    // @capacity: sink队列最多积压的批数，满了丢弃最老的
+    void AddSink(std::shared_ptr<LogSink> sink, int level, size_t capacity = SINK_QUEUE);
+    // 等sink把已经排队的日志写完再移除，之前调用的日志要先Flush才能保证送到
+    void RemoveSink(const std::shared_ptr<LogSink>& sink);
+    // 该sink因队列满丢弃的批数
+    uint64_t SinkDropped(const std::shared_ptr<LogSink>& sink);
+
+    // 组提交：距上次fsync超过interval或者累计写了bytes字节才fsync（Mmap时是msync）一次
+    void SetSyncPolicy(std::chrono::milliseconds interval, size_t bytes);
+
+    // 运行期等级判断，LOG_*宏在求值参数之前调用
+    static bool Enabled(int level) { return level >= s_levelMask.load(std::memory_order_relaxed); }
 
+    // 登记一个调用点的格式串，返回格式id
+    static uint32_t RegisterFormat(int level, std::string_view fmt);
+
+    // 参数按类型序列化，格式化推迟到后台线程；等级已经由调用方判断过。
+    // 有参数不能序列化时（见LogCodec::DEFERRABLE）在调用处整条格式化，按level的内置格式记录
+    template <typename... Args>
+    void WriteFormat(int level, uint32_t formatId, fmt::format_string<Args...> fmt, Args &&...args);
+
+    // 运行时格式串，在调用处格式化
     template <typename... Args>
-    void WriteLog(int level, std::string fmt, Args &&...args);
+    void WriteLog(int level, std::string_view fmt, Args &&...args);
 
+    // 返回时调用前写入的日志都已write并fsync
     void Flush();
 
+    // 停掉后台线程，落盘并关闭文件
     void Stop();
 
+    // 因缓冲区满或单条超过缓冲区一半被丢弃的日志条数
+    uint64_t Dropped() const;
+
 private:
-    // need change to new file or buffer reach m_logQueue
-    void AutoFlush();
+    // 本线程复用的格式化缓冲区
+    static fmt::memory_buffer& LocalBuffer();
+    // 本线程的环形缓冲区，第一次调用时创建并登记
+    LogRing& LocalRing();
+    // 把一条记录的负载放进本线程的环形缓冲区
+    void Publish(std::string_view payload);
+
+    void WriterLoop();
+    void StartWriter();
+    void StopWriter();
 
-    void CreateLog(std::string time);
+    // 以下持mut调用
+    // 按时间戳归并各线程缓冲区，最多取maxLines条拼进m_buffer后一次write，返回条数
+    size_t WriteRings(size_t maxLines);
+    // 把各线程缓冲区中现有的日志全部写出
+    void DrainRings();
+    bool RingsEmpty();
+    void RefreshRings();
+    // 按模式把一条记录格式化成文本或者编码成二进制追加到m_buffer，跨天时切换文件
+    void AppendRecord(uint64_t ts, std::string_view payload);
+    void WriteBuffer();
+    // 把这一批文本交给各个sink
+    void PublishBatch();
+    // 运行期等级取文件和各sink里最低的
+    void UpdateLevelMask();
+    void Sync();
+    void MaybeSync();
+    // 距下次按时间fsync还要等多久，-1表示没有待fsync的数据
+    int32_t SyncWaitMs() const;
+
+    // 打开ts所在那一天的文件
+    void CreateLog(uint64_t ts);
+    void CloseLog();
+    bool NeedRotate(uint64_t ts) const;
+    // 关掉当前文件，当天的文件改名为下一个序号，交给后台压缩、清理后打开新文件
+    void Rotate(uint64_t ts, bool newDay);
+    std::filesystem::path NextArchivePath() const;
+
+    // 压缩和清理切换下来的文件，跑在低优先级线程上，不会卡住写线程
+    struct ArchiveJob {
+        std::filesystem::path file;
+        std::function<void(const std::filesystem::path&)> compress;
+        size_t keep = 0;
+        // 日志名，不含目录和日期
+        std::string name;
+        std::filesystem::path active;
+    };
+    void QueueArchive(std::filesystem::path file);
+    void ArchiveLoop();
+    void StopArchiver();
+    static void PruneArchives(const ArchiveJob& job);
+    // file是否形如<name>_<YYYY-MM-DD>[.n][.bin][.压缩后缀]，同目录下别的日志（比如<name>_worker）不算
+    static bool IsArchiveOf(std::string_view file, std::string_view name);
 
     Log();
     virtual ~Log();
@@ -54,25 +210,105 @@ private:
     std::string m_filename;
     std::string m_logtime;
     std::filesystem::path m_fullPath;
-    int m_levelMask;
-    uint32_t m_queueSize;
-    ThreadSafeQueue<std::string> m_logQueue;
-    std::FILE* m_fp;
+    static inline std::atomic<int> s_levelMask{0};
+    int m_fileLevel = 0;
+    uint32_t m_batchSize;
+    int m_fd;
+    // 保护文件、m_buffer和消费各线程缓冲区，后台线程和未启动后台线程时的Flush互斥
     std::mutex mut;
+    std::string m_buffer;
+    LogClock m_clock;
+    // 当前文件对应的本地日期
+    int64_t m_day = 0;
+    LogRotation m_rotation;
+    uint64_t m_fileBytes = 0;
+    uint64_t m_fileOpenedTs = 0;
+
+    // 空路径的任务让压缩线程退出
+    ThreadSafeQueue<ArchiveJob> m_archiveJobs;
+    std::thread m_archiver;
+    LogMode m_mode = LogMode::Text;
+    LogOutput m_output = LogOutput::Write;
+    // Mmap时接管m_fd的写入
+    LogMmapFile m_mmap;
+    // 格式表的副本，以及当前文件里已经写过定义的格式
+    std::vector<LogFormatInfo> m_formats;
+    std::vector<bool> m_formatWritten;
+
+    // 持mut增删，后台写线程持mut往里推
+    std::vector<std::unique_ptr<LogSinkWorker>> m_sinks;
+    int m_sinkLevel = LEVEL_OFF;
+    // 正在攒的一批，写完文件后共享给所有sink
+    std::shared_ptr<LogBatch> m_batch;
 
-    static constexpr size_t TAIL_LEN = 10;
-    static constexpr size_t OFF_SET = 6;
+    // 所有线程的缓冲区，写日志的线程登记时加m_ringsMut
+    std::mutex m_ringsMut;
+    std::vector<std::shared_ptr<LogRing>> m_rings;
+    std::atomic<uint64_t> m_ringsVersion{0};
+    // 消费者持mut使用的副本
+    std::vector<std::shared_ptr<LogRing>> m_readRings;
+    std::vector<LogRing::Entry> m_fronts;
+    std::vector<bool> m_hasFront;
+    uint64_t m_readVersion = 0;
+
+    std::atomic<size_t> m_ringBytes{RING_BYTES};
+    std::atomic<OverflowPolicy> m_policy{OverflowPolicy::DropNewest};
+    std::atomic<uint64_t> m_dropped{0};
+    // 有新日志时叫醒后台线程，没人等时只有一次原子读
+    EventCount m_dataReady;
+
+    std::atomic<int64_t> m_syncIntervalMs{1000};
+    std::atomic<size_t> m_syncBytes{4 << 20};
+    size_t m_unsynced = 0;
+    std::chrono::steady_clock::time_point m_lastSync;
+
+    std::thread m_writer;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stopping{false};
+    // Flush()和后台线程之间的握手
+    std::mutex m_syncMut;
+    std::condition_variable m_syncCv;
+    bool m_writing = false;
+    uint64_t m_flushTicket = 0;
+    uint64_t m_flushedTicket = 0;
+
+    static constexpr size_t RING_BYTES = 1 << 20;
+    static constexpr size_t SINK_QUEUE = 1024;
+    static constexpr int LEVEL_OFF = 4;
+    // 后台线程默认每批取出的最大条数
+    static constexpr size_t FLUSH_BATCH = 256;
 };
 
 template <typename... Args>
-void Log::WriteLog(int level, std::string fmt, Args &&...args)
+void Log::WriteFormat(int level, uint32_t formatId, fmt::format_string<Args...> fmt, Args &&...args)
+{
+    fmt::memory_buffer& buf = LocalBuffer();
+    buf.clear();
+    if constexpr ((LogCodec::DEFERRABLE<Args> && ...)) {
+        LogCodec::Put<uint32_t>(buf, formatId);
+        (LogCodec::Encode(buf, args), ...);
+    } else {
+        LogCodec::Put<uint32_t>(buf, static_cast<uint32_t>(level));
+        size_t at = LogCodec::BeginString(buf);
+        fmt::format_to(std::back_inserter(buf), fmt, std::forward<Args>(args)...);
+        LogCodec::EndString(buf, at);
+    }
+    Publish(std::string_view(buf.data(), buf.size()));
+}
+
+template <typename... Args>
+void Log::WriteLog(int level, std::string_view fmt, Args &&...args)
 {
-    if (level < m_levelMask) {
+    if (!Enabled(level)) {
         return;
     }
-    auto localTimeStr = fmt::format("{:%Y-%m-%d:%H:%M}", std::chrono::system_clock::now());
-    // [level] | time | message
-    fmt = "[{}] | {} |" + fmt + "\n";
-    GetInstance().m_logQueue.Push(fmt::format(fmt::runtime(fmt), LOG_LEVEL[level], localTimeStr, args...));
+    fmt::memory_buffer& buf = LocalBuffer();
+    buf.clear();
+    // 内置格式的id就是等级
+    LogCodec::Put<uint32_t>(buf, static_cast<uint32_t>(level));
+    size_t at = LogCodec::BeginString(buf);
+    fmt::format_to(std::back_inserter(buf), fmt::runtime(fmt), args...);
+    LogCodec::EndString(buf, at);
+    Publish(std::string_view(buf.data(), buf.size()));
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,193 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+#include <stdint.h>
+#include <string.h>
+#include <iosfwd>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "fmt/format.h"
+
+// 延迟格式化：调用处只记下格式id和按类型序列化的参数，后台线程或者离线解码工具再格式化。
+// 一条记录的负载 = 格式id(u32) + 若干个参数，每个参数 = 类型(u8) + 值，整数按本机字节序。
+
+enum class LogArgType : uint8_t {
+    Int,      // i64
+    Uint,     // u64
+    Double,   // f64
+    Char,     // u8
+    Bool,     // u8
+    String,   // u32长度 + 内容
+    Pointer,  // u64
+    Float,    // f32，单独存才能和调用处格式化出一样的最短表示
+};
+
+enum class LogTimePrecision {
+    Minute,       // 2023-09-22:16:31
+    Second,       // 2023-09-22:16:31:05
+    Microsecond,  // 2023-09-22:16:31:05.123456
+};
+
+// 日志时间戳（本地时间）的格式化缓存：只有跨过一分钟（Second/Microsecond精度是一秒）才重新算localtime和格式化，
+// 其余时候直接复用上次的文本，微秒精度只改写末尾6位。只给单个线程用（后台写线程或者解码工具）。
+class LogClock {
+public:
+    explicit LogClock(LogTimePrecision precision = LogTimePrecision::Minute);
+
+    void SetPrecision(LogTimePrecision precision);
+
+    // @ts: system_clock纳秒；返回的文本在下次调用前有效
+    std::string_view Format(uint64_t ts);
+    // 本地时间1970-01-01起的天数，用来判断跨天
+    int64_t Day(uint64_t ts);
+    // YYYY-MM-DD，有效期同Format
+    std::string_view Date(uint64_t ts);
+
+private:
+    void Refresh(uint64_t ts);
+
+private:
+    LogTimePrecision m_precision;
+    // 缓存的文本覆盖[m_begin, m_end)纳秒
+    uint64_t m_begin = 1;
+    uint64_t m_end = 0;
+    int64_t m_day = 0;
+    std::string m_text;
+};
+
+struct LogFormatInfo {
+    int level;
+    std::string pattern;
+};
+
+// 进程内所有调用点的格式串，每个调用点第一次执行时登记一次
+class LogFormatTable {
+public:
+    static LogFormatTable& Instance();
+
+    uint32_t Register(int level, std::string_view pattern);
+    // 把from之后登记的格式追加到out，后台线程用它增量同步一份不加锁的副本
+    void CopySince(size_t from, std::vector<LogFormatInfo>& out);
+
+private:
+    LogFormatTable();
+
+private:
+    std::mutex m_mut;
+    std::vector<LogFormatInfo> m_formats;
+};
+
+// 二进制日志文件：MAGIC后跟一串记录，格式定义总在第一次用到它的日志之前
+//   'F' id(u32) level(u8) len(u32) pattern
+//   'L' id(u32) ts(u64, system_clock纳秒) len(u32) 参数
+// 记录之间的0字节是mmap输出异常退出后留下的预分配空间，解码时跳过
+class LogCodec {
+public:
+    static constexpr std::string_view MAGIC = "XHLOGB1\n";
+    static constexpr char FORMAT_RECORD = 'F';
+    static constexpr char LOG_RECORD = 'L';
+    // Log::WriteLog用的内置格式，id就是日志等级，唯一的参数是调用处格式化好的内容
+    static constexpr uint32_t BUILTIN_FORMATS = 4;
+    // 解码时认可的最大格式id，一个程序的日志调用点远到不了这么多，更大的id当作文件损坏
+    static constexpr uint32_t MAX_FORMAT_ID = UINT16_MAX;
+
+    template <typename T>
+    static void Put(fmt::memory_buffer& buf, T v);
+    template <typename T>
+    static void Put(std::string& buf, T v);
+
+    // 能按类型序列化、由后台线程格式化的参数类型；其余类型整条日志只能在调用处格式化，
+    // 否则格式说明符（比如时间的{:%H:%M}）会作用到预先格式化出来的字符串上
+    template <typename T, typename U = std::remove_cvref_t<T>>
+    static constexpr bool DEFERRABLE =
+        (std::is_arithmetic_v<U> && !std::is_same_v<U, long double>) ||
+        std::is_convertible_v<const U&, std::string_view> ||
+        std::is_same_v<U, const void*> || std::is_same_v<U, void*> || std::is_same_v<U, std::nullptr_t>;
+
+    template <typename T>
+    static void Encode(fmt::memory_buffer& buf, const T& v);
+
+    // 字符串参数先写长度占位，内容直接格式化进buf后再回填长度
+    static size_t BeginString(fmt::memory_buffer& buf);
+    static void EndString(fmt::memory_buffer& buf, size_t at);
+
+    // 拆出负载里的格式id，失败返回false
+    static bool SplitPayload(std::string_view payload, uint32_t& id, std::string_view& args);
+
+    // 追加一行文本日志：[level] | time | message\n
+    static void FormatLine(std::string& out, int level, std::string_view time, std::string_view pattern, std::string_view args);
+
+    static void AppendFormatRecord(std::string& out, uint32_t id, const LogFormatInfo& info);
+    static void AppendLogRecord(std::string& out, uint32_t id, uint64_t ts, std::string_view args);
+
+    // 把二进制日志文件转成文本，文件损坏返回false
+    static bool Decode(std::istream& in, std::ostream& out, LogTimePrecision precision = LogTimePrecision::Minute);
+};
+
+template <typename T>
+void LogCodec::Put(fmt::memory_buffer& buf, T v)
+{
+    const char* p = reinterpret_cast<const char*>(&v);
+    buf.append(p, p + sizeof(v));
+}
+
+template <typename T>
+void LogCodec::Put(std::string& buf, T v)
+{
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+void LogCodec::Encode(fmt::memory_buffer& buf, const T& v)
+{
+    using U = std::remove_cvref_t<T>;
+    auto tag = [&buf](LogArgType type) { buf.push_back(static_cast<char>(type)); };
+    if constexpr (std::is_same_v<U, bool>) {
+        tag(LogArgType::Bool);
+        Put<uint8_t>(buf, v);
+    } else if constexpr (std::is_same_v<U, char>) {
+        tag(LogArgType::Char);
+        Put<char>(buf, v);
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        tag(LogArgType::Int);
+        Put<int64_t>(buf, v);
+    } else if constexpr (std::is_integral_v<U>) {
+        tag(LogArgType::Uint);
+        Put<uint64_t>(buf, v);
+    } else if constexpr (std::is_same_v<U, float>) {
+        tag(LogArgType::Float);
+        Put<float>(buf, v);
+    } else if constexpr (std::is_floating_point_v<U> && DEFERRABLE<U>) {
+        tag(LogArgType::Double);
+        Put<double>(buf, static_cast<double>(v));
+    } else if constexpr (std::is_convertible_v<const U&, std::string_view>) {
+        std::string_view s = v;
+        tag(LogArgType::String);
+        Put<uint32_t>(buf, static_cast<uint32_t>(s.size()));
+        buf.append(s.data(), s.data() + s.size());
+    } else if constexpr (std::is_same_v<U, const void*> || std::is_same_v<U, void*> || std::is_same_v<U, std::nullptr_t>) {
+        tag(LogArgType::Pointer);
+        Put<uint64_t>(buf, reinterpret_cast<uintptr_t>(static_cast<const void*>(v)));
+    } else {
+        // 预先按{}格式化会丢掉调用处的格式说明符，这类参数整条日志要在调用处格式化，见Log::WriteFormat
+        static_assert(DEFERRABLE<T>, "LogCodec::Encode only takes DEFERRABLE types");
+    }
+}
+
+inline size_t LogCodec::BeginString(fmt::memory_buffer& buf)
+{
+    buf.push_back(static_cast<char>(LogArgType::String));
+    size_t at = buf.size();
+    Put<uint32_t>(buf, 0);
+    return at;
+}
+
+inline void LogCodec::EndString(fmt::memory_buffer& buf, size_t at)
+{
+    uint32_t len = static_cast<uint32_t>(buf.size() - at - sizeof(uint32_t));
+    memcpy(buf.data() + at, &len, sizeof(len));
+}
+#endif
@@ -0,0 +1,56 @@
+#ifndef LOG_MMAP_H
+#define LOG_MMAP_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+// 通过mmap追加写日志文件：文件按窗口大小用fallocate预分配后映射，写线程直接memcpy进映射区，
+// 写满一个窗口再映射下一个。只在关闭时把文件截到实际长度，中途异常退出时末尾会留下一段0。
+// 只给后台写线程用，不加锁。
+class LogMmapFile {
+public:
+    // @window: 每次映射的字节数，向上取整到页大小
+    explicit LogMmapFile(size_t window = WINDOW);
+    ~LogMmapFile();
+
+    LogMmapFile(const LogMmapFile&) = delete;
+    LogMmapFile& operator=(const LogMmapFile&) = delete;
+
+    // 对之后Attach的文件生效
+    void SetWindow(size_t window);
+
+    // 接管一个以O_RDWR打开的文件，从文件末尾接着写
+    // @trimZeros: 去掉上次异常退出留下的预分配空间，文本日志用；二进制记录可能以0结尾，不能截
+    bool Attach(int fd, bool trimZeros);
+    // 落盘、解除映射并把文件截到实际长度，fd仍由调用者关闭。截断失败返回false（errno有效），
+    // 文件末尾会留下预分配的0
+    bool Detach();
+
+    // 返回写进去的字节数，空间分配失败时小于data.size()
+    size_t Append(std::string_view data);
+    // msync还没落盘的部分，已经解除映射的窗口用fdatasync
+    void Sync();
+
+    bool Attached() const { return m_fd >= 0; }
+    // 实际写入的长度
+    uint64_t Size() const { return m_size; }
+
+    static constexpr size_t WINDOW = 64 << 20;
+
+private:
+    bool Map(uint64_t offset);
+    void Unmap();
+
+private:
+    size_t m_window;
+    size_t m_page;
+    int m_fd = -1;
+    char* m_map = nullptr;
+    // 当前窗口在文件里的起点，按页对齐
+    uint64_t m_mapOffset = 0;
+    uint64_t m_size = 0;
+    uint64_t m_synced = 0;
+    // 文件已经预分配到的长度
+    uint64_t m_allocated = 0;
+};
+#endif
@@ -0,0 +1,136 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// 每个写日志的线程独占一个，单生产者单消费者的变长记录环形缓冲区。
+// 记录 = 16字节头 + 日志内容，按16字节对齐；尾部放不下时写一条填充记录绕回开头，
+// 所以每条日志在缓冲区里都是连续的，消费者直接拿string_view读，不用拷贝。
+// 生产者只写m_tail，消费者只写m_head，和SpscQueue一样各自缓存对方的下标。
+class LogRing {
+public:
+    struct Entry {
+        uint64_t ts;
+        std::string_view msg;
+    };
+
+    // @bytes: 向上取整为2的幂，至少4KB
+    explicit LogRing(size_t bytes);
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // 生产者调用，空间不够返回false；超过MaxMessage()的日志永远写不进去，也返回false，
+    // 截断会破坏二进制记录，调用方应先检查长度
+    bool TryWrite(uint64_t ts, std::string_view msg);
+
+    // 消费者调用，队空返回false；entry.msg在Pop之前有效
+    bool Front(Entry& entry);
+    // 消费者调用，丢掉Front()返回的记录
+    void Pop();
+
+    size_t MaxMessage() const { return m_capacity / 2 - sizeof(Header); }
+    size_t Capacity() const { return m_capacity; }
+    // 缓冲区里最多能同时存在的记录条数
+    size_t MaxRecords() const { return m_capacity / sizeof(Header); }
+
+    // 线程退出时由生产者标记，消费者读空后就可以回收
+    void Close() { m_closed.store(true, std::memory_order_release); }
+    bool Closed() const { return m_closed.load(std::memory_order_acquire); }
+
+private:
+    struct Header {
+        uint64_t ts;
+        uint32_t size;
+        // 非0表示这是一条填充记录，值为整条记录占的字节数
+        uint32_t pad;
+    };
+    static_assert(sizeof(Header) == 16);
+    static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ >= sizeof(Header));
+
+    static constexpr size_t ALIGN = sizeof(Header);
+    static constexpr size_t CACHE_LINE = 64;
+
+    static size_t RecordBytes(size_t size) { return (sizeof(Header) + size + ALIGN - 1) & ~(ALIGN - 1); }
+    Header* At(size_t pos) { return reinterpret_cast<Header*>(m_data.get() + (pos & m_mask)); }
+
+private:
+    size_t m_capacity;
+    size_t m_mask;
+    std::unique_ptr<char[]> m_data;
+    std::atomic<bool> m_closed{false};
+    // 消费者侧
+    alignas(CACHE_LINE) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    // 生产者侧
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0;
+};
+
+inline LogRing::LogRing(size_t bytes) {
+    size_t cap = 4096;
+    while (cap < bytes) {
+        cap <<= 1;
+    }
+    m_capacity = cap;
+    m_mask = cap - 1;
+    m_data = std::make_unique<char[]>(cap);
+}
+
+inline bool LogRing::TryWrite(uint64_t ts, std::string_view msg) {
+    if (msg.size() > MaxMessage()) {
+        return false;
+    }
+    size_t need = RecordBytes(msg.size());
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t room = m_capacity - (tail & m_mask);
+    size_t pad = room < need ? room : 0;
+    if (tail + pad + need - m_cachedHead > m_capacity) {
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+        if (tail + pad + need - m_cachedHead > m_capacity) {
+            return false;
+        }
+    }
+    if (pad != 0) {
+        Header* filler = At(tail);
+        filler->pad = static_cast<uint32_t>(pad);
+        tail += pad;
+    }
+    Header* h = At(tail);
+    h->ts = ts;
+    h->size = static_cast<uint32_t>(msg.size());
+    h->pad = 0;
+    memcpy(h + 1, msg.data(), msg.size());
+    m_tail.store(tail + need, std::memory_order_release);
+    return true;
+}
+
+inline bool LogRing::Front(Entry& entry) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        Header* h = At(head);
+        if (h->pad == 0) {
+            entry.ts = h->ts;
+            entry.msg = std::string_view(reinterpret_cast<const char*>(h + 1), h->size);
+            return true;
+        }
+        head += h->pad;
+        m_head.store(head, std::memory_order_release);
+    }
+}
+
+inline void LogRing::Pop() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    m_head.store(head + RecordBytes(At(head)->size), std::memory_order_release);
+}
+#endif
@@ -0,0 +1,86 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "thread_safe_queue.h"
+#include "basic/mail_box.h"
+
+// 日志除了写文件，还可以同时输出到若干个sink（stderr、UDP收集端等）。
+// 后台写线程把每批日志格式化一次放进LogBatch，所有sink共享同一份；
+// 每个sink有自己的线程和有界队列，慢的sink只会丢自己的日志，不会拖住写线程和别的sink。
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+
+    // 在该sink自己的线程上调用，lines是若干行完整的文本日志，每行以\n结尾
+    virtual void Write(std::string_view lines) = 0;
+    // 队列暂时取空时调用
+    virtual void Flush() {}
+};
+
+class StderrSink : public LogSink {
+public:
+    void Write(std::string_view lines) override;
+};
+
+// 按行打包成不超过maxDatagram字节的报文发给收集端，单行超长时拆开发送。
+// socket是非阻塞的，发不出去的报文直接丢掉
+class UdpSink : public LogSink {
+public:
+    UdpSink(std::string ip, int port, size_t maxDatagram = MAX_DATAGRAM);
+
+    void Write(std::string_view lines) override;
+
+    // mail_box默认最多收1024字节的报文
+    static constexpr size_t MAX_DATAGRAM = 1024;
+
+private:
+    void Send(std::string_view datagram);
+
+private:
+    std::string m_ip;
+    int m_port;
+    size_t m_maxDatagram;
+    XH::mail_sender m_sender;
+};
+
+// 后台写线程一批格式化好的文本日志
+struct LogBatch {
+    std::string text;
+    // 每行在text里的结束位置和等级
+    std::vector<std::pair<uint32_t, uint8_t>> lines;
+};
+
+// 一个sink的线程和队列，Log内部使用
+class LogSinkWorker {
+public:
+    // @capacity: 队列里最多积压的批数，满了丢弃最老的
+    LogSinkWorker(std::shared_ptr<LogSink> sink, int level, size_t capacity);
+    // 把队列里已有的日志写完再退出
+    ~LogSinkWorker();
+
+    // 不会阻塞
+    void Push(std::shared_ptr<const LogBatch> batch);
+
+    const std::shared_ptr<LogSink>& Sink() const { return m_sink; }
+    int Level() const { return m_level; }
+    // 因队列满丢弃的批数
+    uint64_t Dropped() const { return m_queue.Dropped(); }
+
+private:
+    void Run();
+
+private:
+    std::shared_ptr<LogSink> m_sink;
+    int m_level;
+    // 空指针让线程退出
+    ThreadSafeQueue<std::shared_ptr<const LogBatch>> m_queue;
+    std::thread m_thread;
+};
+#endif
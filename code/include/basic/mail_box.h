@@ -8,35 +8,140 @@
 #include <stdint.h>
 #include <string>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <vector>
 #include <span>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
 
 namespace XH {
 
-// A wrapper for incoming messages
+class msg_pool;
+
+// A wrapper for incoming messages, lives in a fixed-size slot of a msg_pool
 struct msg_buf
 {
     sockaddr_in src_addr;      // Source address of the message
-    std::vector<uint8_t> buf; // Message content
+    std::span<uint8_t> buf;    // Message content, points into the slot
+
+    uint8_t* slot{nullptr};    // Start of the slot, slot_size() bytes
+    msg_pool* pool{nullptr};   // Owning pool
+    std::vector<uint8_t> reassembled; // Storage of a reassembled message too large for the slot
+};
+
+// Prepended to every datagram by mail_sender::send_fragmented, all fields in network byte order
+struct frag_header
+{
+    uint32_t magic;      // FRAG_MAGIC
+    uint32_t msg_id;     // Per sender message id
+    uint32_t total_len;  // Length of the whole message
+    uint32_t offset;     // Where this fragment goes in the message
+    uint16_t index;      // Fragment index, from 0
+    uint16_t count;      // Number of fragments of the message
+
+    static constexpr uint32_t FRAG_MAGIC = 0x58484652; // "XHFR"
+};
+static_assert(sizeof(frag_header) == 20);
+
+// Largest UDP payload over IPv4
+constexpr size_t MAX_DATAGRAM_SIZE = 65507;
+
+// Hands the slot back to its pool instead of freeing it
+struct msg_buf_deleter
+{
+    void operator()(msg_buf* msg) const noexcept;
+};
+
+using msg_ptr = std::unique_ptr<msg_buf, msg_buf_deleter>;
+
+// Slab allocator with a freelist for msg_buf. Slots are taken in slabs of slab_slots and recycled
+// when their msg_ptr is released, which may happen on any thread, e.g. a thread_pool worker the
+// handler forwarded the message to. The pool stays alive until its owner closes it and every
+// slot is back, so messages may outlive the mail_box.
+class msg_pool
+{
+public:
+    struct stats
+    {
+        uint64_t allocations;  // Heap allocations made for slabs so far
+        uint64_t acquired;     // Slots handed out so far
+        size_t slots;          // Slots owned by the pool
+        size_t in_use;         // Slots currently held by messages
+    };
+
+    static msg_pool* create(size_t slot_size, size_t slab_slots) noexcept;
+
+    // nullptr when a new slab can't be allocated
+    msg_ptr acquire() noexcept;
+
+    // Give up the owner's reference, the pool is freed once every slot is back
+    void close() noexcept;
+
+    size_t slot_size() const noexcept { return m_slot_size; }
+    stats get_stats() const noexcept;
+
+private:
+    friend struct msg_buf_deleter;
+
+    msg_pool(size_t slot_size, size_t slab_slots) noexcept;
+
+    void release(msg_buf* msg) noexcept;
+    // Called with m_mutex held
+    bool grow() noexcept;
+
+    const size_t m_slot_size;
+    const size_t m_slab_slots;
+    mutable std::mutex m_mutex;
+    std::vector<msg_buf*> m_free;
+    std::vector<std::unique_ptr<msg_buf[]>> m_headers;
+    std::vector<std::unique_ptr<uint8_t[]>> m_storage;
+    uint64_t m_allocations{0};
+    uint64_t m_acquired{0};
+    size_t m_in_use{0};
+    bool m_closed{false};
+};
+
+// A received message that points into the mail_box's receive buffers,
+// only valid while the batch handler runs
+struct msg_view
+{
+    sockaddr_in src_addr;           // Source address of the message
+    std::span<const uint8_t> buf;   // Message content
 };
 
 class mail_box
 {
 public:
-    using HandlerT = std::function<void(mail_box*, std::unique_ptr<msg_buf>&&)>;
+    using HandlerT = std::function<void(mail_box*, msg_ptr&&)>;
+    using BatchHandlerT = std::function<void(mail_box*, std::span<const msg_view>)>;
 
-    mail_box() noexcept;
+    // Options for putting fragmented messages back together
+    struct reassembly_options
+    {
+        size_t max_msg_size = 1 << 20;              // Larger messages are dropped
+        size_t max_pending = 64;                    // Incomplete messages kept at once, the oldest goes first
+        std::chrono::milliseconds timeout{1000};    // Incomplete messages older than this are dropped on the next read
+    };
+
+    // Receive up to batch_size datagrams per recvmmsg call, each up to max_msg_size bytes
+    // (at most MAX_DATAGRAM_SIZE), larger ones are truncated by the kernel and dropped
+    explicit mail_box(size_t batch_size = DEFAULT_BATCH_SIZE, size_t max_msg_size = DEFAULT_MAX_MSG_SIZE) noexcept;
 
     ~mail_box() noexcept;
 
-    // Listen on the specified IP and port
+    // Listen on the specified IP and port, -1 if the socket or the buffer pool could not be created
     int bind(const std::string& ip, int port) noexcept;
 
-    // Register a handler to process incoming messages
+    // Register a handler to process incoming messages one by one, each received straight into a pooled msg_buf
     void regist_handler(HandlerT&& handler) noexcept;
 
+    // Register a handler that gets every batch read by one recvmmsg call without copying,
+    // takes precedence over the per-message handler
+    void regist_batch_handler(BatchHandlerT&& handler) noexcept;
+
     // Get the libevent socket for external use
     evutil_socket_t get_sock() const noexcept { return m_fd; }
 
@@ -46,14 +151,75 @@ public:
     // Remove the event from the event loop
     void remove_event() noexcept;
 
+    // Reassemble datagrams sent by mail_sender::send_fragmented, datagrams without a frag_header
+    // are still delivered as they are. Single-fragment messages are delivered from their slot without copying
+    void enable_reassembly(const reassembly_options& options) noexcept;
+
+    size_t max_msg_size() const noexcept { return m_pool ? m_pool->slot_size() : 0; }
+
+    // Datagrams dropped because they were larger than max_msg_size
+    uint64_t truncated() const noexcept { return m_truncated; }
+
+    // Incomplete messages dropped on timeout, eviction or a bad fragment
+    uint64_t reassembly_dropped() const noexcept { return m_reassembly_dropped; }
+
+    // Allocation counters of the msg_buf pool, steady state should not grow allocations
+    msg_pool::stats pool_stats() const noexcept { return m_pool ? m_pool->get_stats() : msg_pool::stats{}; }
+
 private:
     static void onRead(evutil_socket_t fd, short events, void* arg) noexcept;
 
+    // Hand one batch to the registered handler
+    void dispatch(size_t count) noexcept;
+
+    // A message being reassembled
+    struct pending_msg
+    {
+        sockaddr_in src_addr;
+        uint32_t msg_id;
+        uint32_t chunk;     // Payload length of every fragment but the last
+        uint16_t received;
+        std::vector<bool> got;
+        std::vector<uint8_t> data;
+        std::chrono::steady_clock::time_point first_seen;
+    };
+
+    // Payload of datagram i after looking at its frag_header. Returns false when the datagram is
+    // a fragment that doesn't complete a message yet; a completed message is left in m_completed
+    bool unwrap(size_t i, std::span<uint8_t>& payload) noexcept;
+    void expire_pending() noexcept;
+
     evutil_socket_t m_fd{-1};
     struct event* m_mail_event{nullptr};
     struct event_base* m_event_base{nullptr};
     HandlerT m_handler = HandlerT{};
-    static constexpr int MAX_MSG_SIZE = 1024; // Maximum message size
+    BatchHandlerT m_batch_handler = BatchHandlerT{};
+
+    // Refill the receive slots handed to the per-message handler, returns how many are usable
+    size_t refill() noexcept;
+
+    // Receive buffers reused by every recvmmsg call, each one a pooled slot
+    size_t m_batch_size;
+    msg_pool* m_pool;
+    std::vector<msg_ptr> m_slots;
+    std::vector<struct mmsghdr> m_msgs;
+    std::vector<struct iovec> m_iovs;
+    std::vector<sockaddr_in> m_addrs;
+    std::vector<msg_view> m_views;
+
+    bool m_reassemble{false};
+    reassembly_options m_reassembly;
+    std::vector<pending_msg> m_pending;
+    // Messages completed in the current batch, kept until the batch handler returns
+    std::vector<std::vector<uint8_t>> m_completed;
+    uint64_t m_truncated{0};
+    uint64_t m_reassembly_dropped{0};
+
+    static constexpr size_t DEFAULT_MAX_MSG_SIZE = 1024;
+    static constexpr size_t DEFAULT_BATCH_SIZE = 32;
+    static constexpr size_t POOL_SLAB_SLOTS = 64;
+    // Batches read per readiness callback before yielding back to the event loop
+    static constexpr int MAX_BATCHES_PER_READ = 16;
 };
 
 class mail_sender
@@ -63,11 +229,20 @@ public:
     ~mail_sender() noexcept;
 
     // Send a message to the specified IP and port
-    int send(const std::string& ip, int port, std::span<uint8_t> data) noexcept;
+    int send(const std::string& ip, int port, std::span<const uint8_t> data) noexcept;
+
+    // Split data into datagrams of at most max_datagram bytes, each starting with a frag_header,
+    // for a mail_box with reassembly enabled. Returns data.size() or -1 if a fragment failed to send
+    int send_fragmented(const std::string& ip, int port, std::span<const uint8_t> data,
+                        size_t max_datagram = DEFAULT_FRAGMENT_SIZE) noexcept;
+
+    // Fits the default max_msg_size of mail_box
+    static constexpr size_t DEFAULT_FRAGMENT_SIZE = 1024;
 private:
     void set_dst(const std::string& ip, int port) noexcept;
 
     int m_fd{-1};
     struct sockaddr_in m_addr{};
+    uint32_t m_next_msg_id{0};
 };
 } // namespace XH
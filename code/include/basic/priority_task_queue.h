@@ -0,0 +1,120 @@
+#pragma once
+#include "basic/ring_buffer.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace XH {
+
+using priority_t = uint8_t;
+enum class task_priority : priority_t
+{
+    low = 0,
+    normal = 1,
+    high = 2,
+    critical = 3,
+};
+
+inline constexpr std::size_t task_priority_levels = 4;
+
+// One FIFO per priority level plus aging: a task gains one level for every `aging` it has waited,
+// so a steady stream of high priority work delays low priority tasks by a bounded amount instead of
+// starving them. At most one aged task may jump ahead per `aging` interval, otherwise a saturated
+// backlog of old bulk work would all outrank fresh high priority tasks.
+// Only the head of each level is looked at, the heads are always the oldest entries.
+// Not thread-safe, the pool guards it with its tasks mutex.
+template <typename T>
+class priority_task_queue
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+
+    void push(T&& task, const task_priority priority)
+    {
+        m_levels[static_cast<std::size_t>(priority)].push({std::move(task), clock_t::now()});
+        ++m_size;
+    }
+
+    // Caller guarantees the queue is not empty.
+    [[nodiscard]] T pop()
+    {
+        ring_buffer<entry>& level = m_levels[pick_level()];
+        T task = std::move(level.front().task);
+        level.pop();
+        --m_size;
+        return task;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    void set_aging(const clock_t::duration aging) noexcept
+    {
+        m_aging = aging.count() > 0 ? aging : clock_t::duration(1);
+    }
+
+private:
+    struct entry
+    {
+        T task;
+        clock_t::time_point enqueued;
+    };
+
+    [[nodiscard]] std::size_t pick_level()
+    {
+        std::size_t best = task_priority_levels;
+        std::size_t nonempty = 0;
+        for (std::size_t i = task_priority_levels; i-- > 0;)
+        {
+            if (!m_levels[i].empty())
+            {
+                best = (best == task_priority_levels) ? i : best;
+                ++nonempty;
+            }
+        }
+        // Aging only matters when several levels compete, skip the clock read otherwise.
+        if (nonempty < 2)
+            return best;
+
+        const auto now = clock_t::now();
+        if (now - m_last_promotion < m_aging)
+            return best;
+
+        const std::size_t highest = best;
+        auto best_score = effective_level(best, now);
+        for (std::size_t i = best; i-- > 0;)
+        {
+            if (m_levels[i].empty())
+                continue;
+            // Strictly greater: on a tie the higher level wins.
+            if (const auto score = effective_level(i, now); score > best_score)
+            {
+                best = i;
+                best_score = score;
+            }
+        }
+        if (best != highest)
+            m_last_promotion = now;
+        return best;
+    }
+
+    [[nodiscard]] clock_t::rep effective_level(const std::size_t level, const clock_t::time_point now) const
+    {
+        return static_cast<clock_t::rep>(level) + (now - m_levels[level].front().enqueued) / m_aging;
+    }
+
+    std::array<ring_buffer<entry>, task_priority_levels> m_levels;
+    std::size_t m_size = 0;
+    clock_t::duration m_aging = std::chrono::milliseconds(10);
+    clock_t::time_point m_last_promotion = {};
+};
+} // namespace XH
@@ -0,0 +1,103 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace XH {
+
+// Growable circular buffer with std::queue style access at both ends.
+// Capacity only ever grows (doubling), so once a queue has seen its peak depth, pushing and
+// popping never allocate again, unlike std::deque which frees and reallocates chunks constantly.
+// T must be default constructible and move assignable. Not thread-safe.
+template <typename T>
+class ring_buffer
+{
+public:
+    ring_buffer() : ring_buffer(16) {}
+
+    explicit ring_buffer(const std::size_t capacity)
+    {
+        std::size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        m_items.resize(cap);
+    }
+
+    void push(T&& item)
+    {
+        if (m_size == m_items.size())
+            grow();
+        m_items[(m_head + m_size) & mask()] = std::move(item);
+        ++m_size;
+    }
+
+    [[nodiscard]] T& front() noexcept
+    {
+        assert(m_size != 0);
+        return m_items[m_head];
+    }
+
+    [[nodiscard]] const T& front() const noexcept
+    {
+        assert(m_size != 0);
+        return m_items[m_head];
+    }
+
+    [[nodiscard]] T& back() noexcept
+    {
+        assert(m_size != 0);
+        return m_items[(m_head + m_size - 1) & mask()];
+    }
+
+    // Popped slots are reset so captured resources are released right away.
+    void pop() noexcept
+    {
+        assert(m_size != 0);
+        m_items[m_head] = T{};
+        m_head = (m_head + 1) & mask();
+        --m_size;
+    }
+
+    void pop_back() noexcept
+    {
+        assert(m_size != 0);
+        back() = T{};
+        --m_size;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+        return m_items.size();
+    }
+
+private:
+    [[nodiscard]] std::size_t mask() const noexcept
+    {
+        return m_items.size() - 1;
+    }
+
+    void grow()
+    {
+        std::vector<T> items(m_items.size() * 2);
+        for (std::size_t i = 0; i < m_size; ++i)
+            items[i] = std::move(m_items[(m_head + i) & mask()]);
+        m_items = std::move(items);
+        m_head = 0;
+    }
+
+    std::vector<T> m_items;
+    std::size_t m_head = 0;
+    std::size_t m_size = 0;
+};
+} // namespace XH
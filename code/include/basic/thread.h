@@ -5,6 +5,7 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -16,22 +17,39 @@ using thread_t = std::jthread;
 using thread_t = std::thread;
 #endif
 
+// Used to pad data touched by different threads, so they don't bounce the same cache line.
+inline constexpr std::size_t cache_line_size = 64;
+
+// Spin-wait hint: lets the sibling hyperthread run and saves power while polling.
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
 enum class os_thread_priority
 {
 #if defined(__WIN32__)
     idle = THREAD_PRIORITY_IDLE,
-    low = THREAD_PRIORITY_LOWEST,
+    lowest = THREAD_PRIORITY_LOWEST,
+    below_normal = THREAD_PRIORITY_BELOW_NORMAL,
     normal = THREAD_PRIORITY_NORMAL,
     above_normal = THREAD_PRIORITY_ABOVE_NORMAL,
-    high = THREAD_PRIORITY_HIGHEST,
+    highest = THREAD_PRIORITY_HIGHEST,
     realtime = THREAD_PRIORITY_TIME_CRITICAL,
 #elif defined(__linux__) || defined(__APPLE__)
     idle = 0,
-    low = 1,
-    normal = 2,
-    above_normal = 3,
-    high = 4,
-    realtime = 5,
+    lowest = 1,
+    below_normal = 2,
+    normal = 3,
+    above_normal = 4,
+    highest = 5,
+    realtime = 6,
 #endif
 };
 
@@ -54,8 +72,10 @@ public:
     
 
 #ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
-    [[nodiscard]] static std::optional<std : vector<bool>> get_os_thread_affinity() noexcept;
+    // affinity[i] is true when the thread may run on cpu i.
+    [[nodiscard]] static std::optional<std::vector<bool>> get_os_thread_affinity() noexcept;
     static bool set_os_thread_affinity(std::vector<bool> affinity) noexcept;
+    static bool pin_to_cpu(std::size_t cpu) noexcept;
 
     [[nodiscard]] static std::optional<os_thread_priority> get_os_thread_priority() noexcept;
     static bool set_os_thread_priority(const os_thread_priority priority) noexcept;
@@ -65,4 +85,42 @@ public:
     static thread_local std::optional<std::size_t> m_index;
     static thread_local std::optional<void*> m_pool;
 };
+
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+// One logical cpu as described by /sys/devices/system/cpu/cpuN/topology.
+struct cpu_info
+{
+    std::size_t id;
+    std::size_t core;
+    std::size_t package;
+};
+
+// Online cpus, ordered by (package, core, id). Missing topology files degrade to one core per cpu;
+// empty if the topology could not be read at all.
+[[nodiscard]] std::vector<cpu_info> read_cpu_topology() noexcept;
+
+enum class placement_policy
+{
+    // Leave scheduling to the OS.
+    none,
+    // Fill one core (all its hyperthreads), then the next core of the same socket, and so on.
+    // Keeps workers that share data on shared caches.
+    compact,
+    // Spread across sockets first, then across physical cores, hyperthread siblings last.
+    // Gives every worker as much private cache and memory bandwidth as possible.
+    scatter,
+    // Use thread_placement::cpus as given.
+    explicit_list,
+};
+
+struct thread_placement
+{
+    placement_policy policy = placement_policy::none;
+    // For placement_policy::explicit_list, worker i runs on cpus[i % cpus.size()].
+    std::vector<std::size_t> cpus = {};
+};
+
+// Cpu for each of @count workers, empty when nothing should be pinned.
+[[nodiscard]] std::vector<std::size_t> placement_cpus(const thread_placement& placement, const std::vector<cpu_info>& topology, std::size_t count);
+#endif
 } // namespace XH
\ No newline at end of file
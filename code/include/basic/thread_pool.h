@@ -1,24 +1,36 @@
 #pragma once
+#include "basic/inplace_task.h"
+#include "basic/priority_task_queue.h"
+#include "basic/ring_buffer.h"
 #include "basic/thread.h"
+#include "basic/thread_pool_stats.h"
+#include "basic/timer_wheel.h"
+#include "basic/work_steal_queue.h"
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
 #include <cstdint>
 #include <functional>
+#include <future>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
+#include <span>
 #include <string>
 #include <thread>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace XH {
 
 #ifdef __cpp_lib_move_only_function
 template <typename... S>
-using function_t = std::move_only_function<S...>
+using function_t = std::move_only_function<S...>;
 #else
 template <typename... S>
 using function_t = std::function<S...>;
@@ -30,7 +42,11 @@ using function_t = std::function<S...>;
     wait_deadlock() : std::runtime_error("wait_deadlock") {};
 };
 #endif
-using task_t = function_t<void()>;
+// Inline capture budget of a task; 56 bytes keeps a whole task_t on one cache line.
+#ifndef XH_TASK_INLINE_SIZE
+    #define XH_TASK_INLINE_SIZE 56
+#endif
+using task_t = inplace_task<XH_TASK_INLINE_SIZE>;
 
 using opt_t = uint8_t;
 enum class topt_t : opt_t
@@ -39,6 +55,9 @@ enum class topt_t : opt_t
     pause = 1 << 0,
     priority = 1 << 1,
     deadlock_detect = 1 << 2,
+    work_stealing = 1 << 3,
+    // Per-worker counters and a queue-wait histogram, read through thread_pool::snapshot().
+    stats = 1 << 4,
 };
 
 constexpr opt_t operator&(const topt_t lhs, const topt_t rhs) noexcept
@@ -51,6 +70,94 @@ constexpr topt_t operator|(const topt_t lhs, const topt_t rhs) noexcept
     return static_cast<topt_t>(static_cast<opt_t>(lhs) | static_cast<opt_t>(rhs));
 }
 
+// Splits the index range [first, last) into contiguous blocks of near equal size, so every worker
+// walks its own slice of memory sequentially instead of interleaving element by element.
+template <typename T>
+class blocks
+{
+public:
+    blocks(const T first, const T last, std::size_t num_blocks) : m_first(first), m_last(last)
+    {
+        if (m_last <= m_first)
+        {
+            m_num_blocks = 0;
+            return;
+        }
+        const std::size_t total = static_cast<std::size_t>(m_last - m_first);
+        m_num_blocks = std::max<std::size_t>(1, std::min(num_blocks, total));
+        m_block_size = total / m_num_blocks;
+        m_remainder = total % m_num_blocks;
+    }
+
+    // The first m_remainder blocks take one extra index each.
+    [[nodiscard]] T start(const std::size_t block) const noexcept
+    {
+        return m_first + static_cast<T>(block * m_block_size + std::min(block, m_remainder));
+    }
+
+    [[nodiscard]] T end(const std::size_t block) const noexcept
+    {
+        return (block == m_num_blocks - 1) ? m_last : start(block + 1);
+    }
+
+    [[nodiscard]] std::size_t get_num_blocks() const noexcept
+    {
+        return m_num_blocks;
+    }
+
+private:
+    T m_first;
+    T m_last;
+    std::size_t m_num_blocks = 0;
+    std::size_t m_block_size = 0;
+    std::size_t m_remainder = 0;
+};
+
+// Futures of one parallel submission, waited on or collected together.
+template <typename R>
+class multi_future : public std::vector<std::future<R>>
+{
+public:
+    using std::vector<std::future<R>>::vector;
+
+    // Returns the results in block order; void results just wait and rethrow.
+    [[nodiscard]] std::conditional_t<std::is_void_v<R>, void, std::vector<R>> get()
+    {
+        if constexpr (std::is_void_v<R>)
+        {
+            for (std::future<R>& future : *this)
+                future.get();
+        }
+        else
+        {
+            std::vector<R> results;
+            results.reserve(this->size());
+            for (std::future<R>& future : *this)
+                results.push_back(future.get());
+            return results;
+        }
+    }
+
+    void wait() const
+    {
+        for (const std::future<R>& future : *this)
+            future.wait();
+    }
+};
+
+// What an idle worker does before it finds new work.
+enum class idle_strategy : uint8_t
+{
+    // Sleep on the condition variable right away, cheapest on CPU but pays a futex wake per task.
+    block,
+    // Poll the queue for an adaptive number of pause iterations, then sleep.
+    spin_then_block,
+    // Never sleep, for workers pinned to dedicated cores.
+    busy_poll,
+};
+
+inline constexpr std::size_t default_max_spins = 1 << 14;
+
 #ifdef __cpp_lib_jthread
     #define THREAD_POOL_WORKER_TOKEN const std::stop_token &stop_token,
     #define THREAD_POOL_WAIT_TOKEN stop_token,
@@ -66,6 +173,10 @@ constexpr topt_t operator|(const topt_t lhs, const topt_t rhs) noexcept
 template <topt_t options = topt_t::none>
 class thread_pool
 {
+    static constexpr bool stats_enabled = !!(options & topt_t::stats);
+    //@brief What the queues hold: the bare task, or the task plus its enqueue time in stats mode.
+    using queued_t = std::conditional_t<stats_enabled, timed_task<task_t>, task_t>;
+
 public:
     thread_pool() : thread_pool(0, [] {}) {}
 
@@ -79,6 +190,19 @@ public:
         create_threads(num_threads, std::forward<F>(init_func));
     }
 
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+    // Pins every worker to a cpu chosen by @placement before its init function runs.
+    thread_pool(const std::size_t num_threads, const thread_placement& placement) : thread_pool(num_threads, [] {}, placement) {}
+
+    template <THREAD_POOL_INIT_FUNC_CONCEPT(F)>
+    thread_pool(const std::size_t num_threads, F&& init_func, const thread_placement& placement)
+    {
+        if (placement.policy != placement_policy::none)
+            m_worker_cpus = placement_cpus(placement, read_cpu_topology(), determine_num_threads(num_threads));
+        create_threads(num_threads, std::forward<F>(init_func));
+    }
+#endif
+
     thread_pool(const thread_pool&) = delete;
     thread_pool(thread_pool&&) = delete;
     thread_pool& operator=(const thread_pool&) = delete;
@@ -91,6 +215,7 @@ public:
         {
 #endif
             // wait();
+            stop_timer_thread();
             m_tasks_available_cv.notify_all();
 #ifndef __cpp_lib_jthread
             destroy_threads();
@@ -136,9 +261,9 @@ public:
             [this]
             {
                 if constexpr (pause_enabled)
-                    return (m_tasks_running == 0) && (m_paused || m_tasks.empty());
+                    return (m_tasks_running == 0) && (m_paused || tasks_empty());
                 else
-                    return (m_tasks_running == 0) && m_tasks.empty();
+                    return (m_tasks_running == 0) && tasks_empty();
             });
         m_waiting = false;
     }
@@ -159,11 +284,204 @@ public:
         }
     }
 
-    void submit_task(task_t&& task)
+    // @priority is only honoured when the pool is built with topt_t::priority.
+    void submit_task(task_t&& task, const task_priority priority = task_priority::normal)
     {
-        std::unique_lock tasks_lock(m_tasks_mutex);
-        m_tasks.push(std::move(task));
-        m_tasks_available_cv.notify_one();
+        if constexpr (work_stealing_enabled)
+        {
+            submit_local_task(std::move(task));
+        }
+        else
+        {
+            std::unique_lock tasks_lock(m_tasks_mutex);
+            if constexpr (priority_enabled)
+                m_tasks.push(to_queued(std::move(task)), priority);
+            else
+                m_tasks.push(to_queued(std::move(task)));
+            m_tasks_queued.store(m_tasks.size(), std::memory_order_relaxed);
+            m_tasks_available_cv.notify_one();
+        }
+    }
+
+    // Enqueues [first, last) under a single lock round-trip and wakes at most one idle worker per
+    // task instead of notifying once per task. Elements are moved from.
+    template <typename It>
+    void submit_bulk(It first, It last, const task_priority priority = task_priority::normal)
+    {
+        const std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+        if (count == 0)
+            return;
+
+        if constexpr (work_stealing_enabled)
+        {
+            submit_local_bulk(first, count);
+        }
+        else
+        {
+            {
+                const std::scoped_lock tasks_lock(m_tasks_mutex);
+                for (; first != last; ++first)
+                {
+                    if constexpr (priority_enabled)
+                        m_tasks.push(to_queued(task_t(std::move(*first))), priority);
+                    else
+                        m_tasks.push(to_queued(task_t(std::move(*first))));
+                }
+                m_tasks_queued.store(m_tasks.size(), std::memory_order_relaxed);
+            }
+            wake_workers(count);
+        }
+    }
+
+    void submit_bulk(std::span<task_t> tasks, const task_priority priority = task_priority::normal)
+    {
+        submit_bulk(tasks.begin(), tasks.end(), priority);
+    }
+
+    // How workers wait for work once their queue runs dry; can be changed at any time.
+    // @max_spins bounds the spin phase of idle_strategy::spin_then_block.
+    void set_idle_strategy(const idle_strategy strategy, const std::size_t max_spins = default_max_spins) noexcept
+    {
+        m_max_spins.store(max_spins, std::memory_order_relaxed);
+        m_idle_strategy.store(strategy, std::memory_order_relaxed);
+    }
+
+    // Submits @task once @delay has elapsed, with timer_tick resolution. Cancel through the handle.
+    // wait() only covers tasks already submitted, not timers that are still pending.
+    template <typename Rep, typename Period>
+    timer_handle<task_t> schedule_after(const std::chrono::duration<Rep, Period> delay, task_t&& task)
+    {
+        return schedule_timer(to_ticks(delay), 0, std::move(task));
+    }
+
+    // Submits @task every @period, the first run one period from now. If a run takes longer than
+    // the period, the next one may overlap with it on another worker.
+    template <typename Rep, typename Period>
+    timer_handle<task_t> schedule_every(const std::chrono::duration<Rep, Period> period, task_t&& task)
+    {
+        const uint64_t ticks = std::max<uint64_t>(1, to_ticks(period));
+        return schedule_timer(ticks, ticks, std::move(task));
+    }
+
+    // Awaitable that resumes the awaiting coroutine on one of the workers. The resumption is an
+    // ordinary queued task, so it goes through the worker loop like any other (priorities, stealing
+    // and stats included) and fits inline in task_t.
+    [[nodiscard]] auto schedule(const task_priority priority = task_priority::normal) noexcept
+    {
+        struct awaiter
+        {
+            [[nodiscard]] bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(const std::coroutine_handle<> handle)
+            {
+                pool.submit_task([handle] { handle.resume(); }, priority);
+            }
+
+            void await_resume() const noexcept {}
+
+            thread_pool& pool;
+            task_priority priority;
+        };
+        return awaiter{*this, priority};
+    }
+
+    // Runs @task on the pool and hands its result (or exception) back through a future.
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit(F&& task, const task_priority priority = task_priority::normal)
+    {
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        submit_task(
+            [task = std::forward<F>(task), promise = std::move(promise)]() mutable
+            {
+#ifdef __cpp_exceptions
+                try
+                {
+#endif
+                    if constexpr (std::is_void_v<R>)
+                    {
+                        task();
+                        promise.set_value();
+                    }
+                    else
+                    {
+                        promise.set_value(task());
+                    }
+#ifdef __cpp_exceptions
+                }
+                catch (...)
+                {
+                    promise.set_exception(std::current_exception());
+                }
+#endif
+            },
+            priority);
+        return future;
+    }
+
+    // Calls @loop(i) for every i in [first, last), one task per block. Use wait() to join.
+    // @num_blocks defaults to the number of threads.
+    template <typename T, typename F>
+    void detach_loop(const T first, const T last, F&& loop, const std::size_t num_blocks = 0, const task_priority priority = task_priority::normal)
+    {
+        const blocks<T> blks(first, last, num_blocks ? num_blocks : m_threads_count);
+        const std::shared_ptr<std::decay_t<F>> shared_loop = std::make_shared<std::decay_t<F>>(std::forward<F>(loop));
+        for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
+        {
+            submit_task(
+                [shared_loop, start = blks.start(blk), end = blks.end(blk)]
+                {
+                    for (T i = start; i < end; ++i)
+                        (*shared_loop)(i);
+                },
+                priority);
+        }
+    }
+
+    // Calls @block(start, end) once per block of [first, last) and collects the results.
+    template <typename T, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
+    [[nodiscard]] multi_future<R> submit_blocks(const T first, const T last, F&& block, const std::size_t num_blocks = 0, const task_priority priority = task_priority::normal)
+    {
+        const blocks<T> blks(first, last, num_blocks ? num_blocks : m_threads_count);
+        const std::shared_ptr<std::decay_t<F>> shared_block = std::make_shared<std::decay_t<F>>(std::forward<F>(block));
+        multi_future<R> futures;
+        futures.reserve(blks.get_num_blocks());
+        for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
+        {
+            futures.push_back(submit(
+                [shared_block, start = blks.start(blk), end = blks.end(blk)]
+                {
+                    return (*shared_block)(start, end);
+                },
+                priority));
+        }
+        return futures;
+    }
+
+    // A queued task is promoted by one priority level for every @aging it has waited.
+    template <typename Rep, typename Period>
+    void set_priority_aging(const std::chrono::duration<Rep, Period> aging)
+    {
+        static_assert(priority_enabled, "priority aging requires topt_t::priority");
+        const std::scoped_lock tasks_lock(m_tasks_mutex);
+        m_tasks.set_aging(std::chrono::duration_cast<std::chrono::steady_clock::duration>(aging));
+    }
+
+    // Counters of every worker plus the current queue depth. Cheap enough to poll from a
+    // monitoring thread, the workers are never stopped or locked.
+    [[nodiscard]] pool_stats snapshot() const
+    {
+        static_assert(stats_enabled, "snapshot requires topt_t::stats");
+        pool_stats stats;
+        stats.queued_tasks = m_tasks_queued.load(std::memory_order_relaxed);
+        stats.idle_workers = m_idle_workers.load(std::memory_order_relaxed);
+        stats.workers.reserve(m_threads_count);
+        for (std::size_t i = 0; i < m_threads_count; ++i)
+            stats.workers.push_back(m_stats[i].snapshot());
+        return stats;
     }
 
 private:
@@ -183,6 +501,10 @@ private:
         }
         m_threads_count = determine_num_threads(num_threads);
         m_threads = std::make_unique<thread_t[]>(m_threads_count);
+        if constexpr (work_stealing_enabled)
+            m_local_tasks = std::make_unique<work_steal_queue<queued_t>[]>(m_threads_count);
+        if constexpr (stats_enabled)
+            m_stats = std::make_unique<worker_counters[]>(m_threads_count);
 
         {
             std::unique_lock lock(m_tasks_mutex);
@@ -199,7 +521,10 @@ private:
                 (const std::stop_token& stop_token)
 #endif
                 {
-                    worker(THREAD_POOL_WAIT_TOKEN i);
+                    if constexpr (work_stealing_enabled)
+                        stealing_worker(THREAD_POOL_WAIT_TOKEN i);
+                    else
+                        worker(THREAD_POOL_WAIT_TOKEN i);
                 });
         }
     }
@@ -220,23 +545,219 @@ private:
         }
     }
 
-    [[nodiscard]] task_t pop_task()
+    template <typename Rep, typename Period>
+    [[nodiscard]] static uint64_t to_ticks(const std::chrono::duration<Rep, Period> duration)
+    {
+        const auto ticks = std::chrono::ceil<std::chrono::milliseconds>(duration) / timer_tick;
+        return ticks > 0 ? static_cast<uint64_t>(ticks) : 0;
+    }
+
+    [[nodiscard]] uint64_t current_tick() const
+    {
+        return static_cast<uint64_t>((std::chrono::steady_clock::now() - m_timer_epoch) / timer_tick);
+    }
+
+    timer_handle<task_t> schedule_timer(const uint64_t delay, const uint64_t period, task_t&& task)
+    {
+        std::call_once(m_timer_once,
+            [this]
+            {
+                m_timer_epoch = std::chrono::steady_clock::now();
+                m_timer_wheel = std::make_shared<timer_wheel<task_t>>();
+                m_timer_thread = thread_t([this] { timer_loop(); });
+            });
+        std::shared_ptr<timer_node<task_t>> node = std::make_shared<timer_node<task_t>>();
+        node->callback = std::move(task);
+        m_timer_wheel->add(node, current_tick(), delay, period);
+        {
+            const std::scoped_lock timer_lock(m_timer_mutex);
+        }
+        m_timer_cv.notify_one();
+        return {m_timer_wheel, std::move(node)};
+    }
+
+    // Ticks the wheel while timers are pending and hands whatever came due to the workers in one batch.
+    void timer_loop()
+    {
+        std::vector<std::shared_ptr<timer_node<task_t>>> expired;
+        std::vector<task_t> batch;
+        std::unique_lock timer_lock(m_timer_mutex);
+        while (!m_timer_stop)
+        {
+            if (m_timer_wheel->size() == 0)
+                m_timer_cv.wait(timer_lock, [this] { return m_timer_stop || m_timer_wheel->size() > 0; });
+            else
+            {
+                // Sleep straight to the next occupied slot instead of waking every tick. No predicate:
+                // schedule_timer notifies after adding, and an earlier timer needs a new deadline.
+                m_timer_cv.wait_until(timer_lock, m_timer_epoch + m_timer_wheel->next_expiry() * timer_tick);
+            }
+            if (m_timer_stop)
+                break;
+
+            timer_lock.unlock();
+            m_timer_wheel->advance(current_tick(), expired);
+            for (std::shared_ptr<timer_node<task_t>>& node : expired)
+            {
+                batch.emplace_back(
+                    [node = std::move(node)]
+                    {
+                        if (node->claim_run())
+                            node->callback();
+                    });
+            }
+            expired.clear();
+            submit_bulk(batch.begin(), batch.end());
+            batch.clear();
+            timer_lock.lock();
+        }
+    }
+
+    void stop_timer_thread()
+    {
+        if (!m_timer_thread.joinable())
+            return;
+        {
+            const std::scoped_lock timer_lock(m_timer_mutex);
+            m_timer_stop = true;
+        }
+        m_timer_cv.notify_all();
+        m_timer_thread.join();
+    }
+
+    void wake_workers(const std::size_t count)
     {
-        task_t task;
-        task = std::move(m_tasks.front());
-        m_tasks.pop();
+        if (count >= m_idle_workers)
+        {
+            m_tasks_available_cv.notify_all();
+        }
+        else
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                m_tasks_available_cv.notify_one();
+        }
+    }
+
+    [[nodiscard]] bool tasks_empty() const
+    {
+        if constexpr (work_stealing_enabled)
+            return m_tasks_queued == 0;
+        else
+            return m_tasks.empty();
+    }
+
+    // Stamps the enqueue time when statistics are enabled, otherwise passes @task through untouched.
+    [[nodiscard]] static decltype(auto) to_queued(task_t&& task)
+    {
+        if constexpr (stats_enabled)
+            return queued_t(std::move(task));
+        else
+            return std::move(task);
+    }
+
+    [[nodiscard]] queued_t pop_task()
+    {
+        queued_t task;
+        if constexpr (priority_enabled)
+        {
+            task = m_tasks.pop();
+        }
+        else
+        {
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        m_tasks_queued.store(m_tasks.size(), std::memory_order_relaxed);
         return task;
     }
 
-    void worker(THREAD_POOL_WORKER_TOKEN const std::size_t idx)
+    // Called with the tasks lock held, right after the worker went idle. Releases the lock while
+    // spinning so wait() and submitters are not held up, and re-acquires it before returning.
+    // The spin budget adapts to the arrival rate: work that shows up inside the window doubles
+    // it, a window that runs out empty halves it.
+    void spin_for_tasks(THREAD_POOL_WORKER_TOKEN std::unique_lock<std::mutex>& tasks_lock, std::size_t& spin_limit)
+    {
+        const idle_strategy strategy = m_idle_strategy.load(std::memory_order_relaxed);
+        if (strategy == idle_strategy::block || m_tasks_queued.load(std::memory_order_relaxed) > 0)
+            return;
+
+        const std::size_t max_spins = m_max_spins.load(std::memory_order_relaxed);
+        spin_limit = std::clamp<std::size_t>(spin_limit, min_spins, std::max(min_spins, max_spins));
+        tasks_lock.unlock();
+        bool found = false;
+        for (std::size_t i = 0; strategy == idle_strategy::busy_poll || i < spin_limit; ++i)
+        {
+            if (m_tasks_queued.load(std::memory_order_relaxed) > 0)
+            {
+                found = true;
+                break;
+            }
+            if (THREAD_POOL_STOP_CONDITION)
+                break;
+            cpu_relax();
+        }
+        if (strategy == idle_strategy::spin_then_block)
+            spin_limit = found ? spin_limit * 2 : spin_limit / 2;
+        tasks_lock.lock();
+    }
+
+    void init_worker(const std::size_t idx)
     {
         this_thread::m_index = idx;
         this_thread::m_pool = this;
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+        if (!m_worker_cpus.empty())
+            this_thread::pin_to_cpu(m_worker_cpus[idx]);
+#endif
         m_init_func(idx);
+    }
+
+    // Worker @idx ran out of work. Returns when, to be passed to end_idle().
+    [[nodiscard]] std::chrono::steady_clock::time_point begin_idle(const std::size_t idx) noexcept
+    {
+        if constexpr (stats_enabled)
+        {
+            worker_counters::add(m_stats[idx].waits, 1);
+            return std::chrono::steady_clock::now();
+        }
+        else
+        {
+            return {};
+        }
+    }
+
+    void end_idle(const std::size_t idx, const std::chrono::steady_clock::time_point idle_since) noexcept
+    {
+        if constexpr (stats_enabled)
+            worker_counters::add(m_stats[idx].idle_ns, worker_counters::to_ns(std::chrono::steady_clock::now() - idle_since));
+    }
+
+    void run_task(const std::size_t idx, queued_t& task)
+    {
+        if constexpr (stats_enabled)
+        {
+            worker_counters& counters = m_stats[idx];
+            const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+            counters.record_queue_wait(started - task.enqueued);
+            task.task();
+            worker_counters::add(counters.busy_ns, worker_counters::to_ns(std::chrono::steady_clock::now() - started));
+            worker_counters::add(counters.tasks_executed, 1);
+        }
+        else
+        {
+            task();
+        }
+    }
+
+    void worker(THREAD_POOL_WORKER_TOKEN const std::size_t idx)
+    {
+        init_worker(idx);
+        std::size_t spin_limit = m_max_spins;
 
         while (true)
         {
             std::unique_lock tasks_lock(m_tasks_mutex);
+            const std::chrono::steady_clock::time_point idle_since = begin_idle(idx);
             --m_tasks_running;
             bool paused;
             if constexpr (pause_enabled)
@@ -248,32 +769,36 @@ private:
             {
                 m_tasks_done_cv.notify_all();
             }
+            spin_for_tasks(THREAD_POOL_WAIT_TOKEN tasks_lock, spin_limit);
+            ++m_idle_workers;
             m_tasks_available_cv.wait(tasks_lock, THREAD_POOL_WAIT_TOKEN
                 [THREAD_POOL_WAIT_TOKEN this, paused]
                 {
                     return THREAD_POOL_OR_STOP_CONDITION !(paused || m_tasks.empty());
                 });
+            --m_idle_workers;
 
             if (THREAD_POOL_STOP_CONDITION)
             {
                 break;
             }
 
-            task_t task = pop_task();
+            queued_t task = pop_task();
             ++m_tasks_running;
             tasks_lock.unlock();
+            end_idle(idx, idle_since);
 
 #ifdef __cpp_exception
             try
             {
-                task();
+                run_task(idx, task);
             }
             catch (...)
             {
                 // Handle exception
             }
 #else
-            task();
+            run_task(idx, task);
 #endif
         }
         m_cleanup_func(idx);
@@ -281,12 +806,134 @@ private:
         this_thread::m_pool = std::nullopt;
     }
 
+    // Tasks submitted from one of our workers stay on that worker's deque, anything else is
+    // spread round-robin, so producers never meet on a single lock.
+    void submit_local_task(task_t&& task)
+    {
+        std::size_t idx = 0;
+        if (this_thread::get_pool() == this)
+            idx = this_thread::get_index().value();
+        else
+            idx = m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_threads_count;
+
+        // Count the task before it becomes visible, so a thief never drives the counter below zero.
+        ++m_tasks_queued;
+        m_local_tasks[idx].push(to_queued(std::move(task)));
+        if (m_idle_workers > 0)
+        {
+            // Pairs with the predicate check in stealing_worker: a worker is either still before
+            // its check (and will see m_tasks_queued) or already parked on the condition variable.
+            {
+                const std::scoped_lock tasks_lock(m_tasks_mutex);
+            }
+            m_tasks_available_cv.notify_one();
+        }
+    }
+
+    // A worker keeps the whole batch on its own deque for others to steal, an external producer
+    // deals it out in one contiguous chunk per deque.
+    template <typename It>
+    void submit_local_bulk(It first, const std::size_t count)
+    {
+        m_tasks_queued += count;
+        if (this_thread::get_pool() == this)
+        {
+            m_local_tasks[this_thread::get_index().value()].push_bulk(first, count);
+        }
+        else
+        {
+            const std::size_t chunks = std::min(count, m_threads_count);
+            const std::size_t start = m_next_queue.fetch_add(chunks, std::memory_order_relaxed);
+            const blocks<std::size_t> blks(0, count, chunks);
+            for (std::size_t blk = 0; blk < chunks; ++blk)
+            {
+                const std::size_t size = blks.end(blk) - blks.start(blk);
+                m_local_tasks[(start + blk) % m_threads_count].push_bulk(first, size);
+                std::advance(first, size);
+            }
+        }
+        if (m_idle_workers > 0)
+        {
+            {
+                const std::scoped_lock tasks_lock(m_tasks_mutex);
+            }
+            wake_workers(count);
+        }
+    }
+
+    [[nodiscard]] bool pop_local_task(const std::size_t idx, queued_t& task)
+    {
+        if (m_local_tasks[idx].pop(task))
+            return true;
+        for (std::size_t i = 1; i < m_threads_count; ++i)
+        {
+            if (m_local_tasks[(idx + i) % m_threads_count].steal(task))
+            {
+                if constexpr (stats_enabled)
+                    worker_counters::add(m_stats[idx].steals, 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void stealing_worker(THREAD_POOL_WORKER_TOKEN const std::size_t idx)
+    {
+        init_worker(idx);
+        std::size_t spin_limit = m_max_spins;
+
+        while (true)
+        {
+            queued_t task;
+            if (pop_local_task(idx, task))
+            {
+                --m_tasks_queued;
+                run_task(idx, task);
+                continue;
+            }
+
+            std::unique_lock tasks_lock(m_tasks_mutex);
+            const std::chrono::steady_clock::time_point idle_since = begin_idle(idx);
+            --m_tasks_running;
+            bool paused;
+            if constexpr (pause_enabled)
+                paused = m_paused;
+            else
+                paused = false;
+
+            if (m_waiting && (m_tasks_running == 0) && (paused || m_tasks_queued == 0))
+            {
+                m_tasks_done_cv.notify_all();
+            }
+            spin_for_tasks(THREAD_POOL_WAIT_TOKEN tasks_lock, spin_limit);
+            ++m_idle_workers;
+            m_tasks_available_cv.wait(tasks_lock, THREAD_POOL_WAIT_TOKEN
+                [THREAD_POOL_WAIT_TOKEN this, paused]
+                {
+                    return THREAD_POOL_OR_STOP_CONDITION !(paused || m_tasks_queued == 0);
+                });
+            --m_idle_workers;
+            ++m_tasks_running;
+
+            if (THREAD_POOL_STOP_CONDITION)
+            {
+                break;
+            }
+            end_idle(idx, idle_since);
+        }
+        m_cleanup_func(idx);
+        this_thread::m_index = std::nullopt;
+        this_thread::m_pool = std::nullopt;
+    }
+
 private:
     static constexpr bool pause_enabled = !!(options & topt_t::pause);
+    static constexpr std::size_t min_spins = 64;
+    static constexpr std::chrono::milliseconds timer_tick{1};
     static constexpr bool deadlock_detect_enabled = !!(options & topt_t::deadlock_detect);
-
-    // TODO
+    static constexpr bool work_stealing_enabled = !!(options & topt_t::work_stealing);
     static constexpr bool priority_enabled = !!(options & topt_t::priority);
+    static_assert(!(priority_enabled && work_stealing_enabled), "topt_t::priority and topt_t::work_stealing are mutually exclusive");
 
 private:
     //@brief An initialization function that is called when a thread is created.
@@ -301,13 +948,38 @@ private:
     std::conditional_t<pause_enabled, bool, std::monostate> m_paused = {};
 
     std::unique_ptr<thread_t[]> m_threads = nullptr;
-    std::conditional_t<priority_enabled, std::priority_queue<task_t>, std::queue<task_t>> m_tasks = {};
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+    //@brief Cpu of each worker, empty when workers are not pinned.
+    std::vector<std::size_t> m_worker_cpus = {};
+#endif
+    std::conditional_t<priority_enabled, priority_task_queue<queued_t>, ring_buffer<queued_t>> m_tasks = {};
+
+    //@brief Per-worker deques, only allocated in work-stealing mode.
+    std::unique_ptr<work_steal_queue<queued_t>[]> m_local_tasks = nullptr;
+    //@brief Per-worker counters, only allocated in stats mode.
+    std::unique_ptr<worker_counters[]> m_stats = nullptr;
+    //@brief Queued task count. Authoritative in work-stealing mode, otherwise a mirror of m_tasks.size()
+    // that spinning workers can poll without taking the lock.
+    std::atomic<std::size_t> m_tasks_queued = 0;
+    std::atomic<std::size_t> m_idle_workers = 0;
+    std::atomic<std::size_t> m_next_queue = 0;
+    std::atomic<idle_strategy> m_idle_strategy = idle_strategy::block;
+    std::atomic<std::size_t> m_max_spins = default_max_spins;
 
     std::condition_variable m_tasks_done_cv;
     std::condition_variable_any m_tasks_available_cv;
 
+    //@brief Timer wheel and its ticking thread, created by the first schedule_after / schedule_every.
+    std::once_flag m_timer_once;
+    std::shared_ptr<timer_wheel<task_t>> m_timer_wheel = nullptr;
+    std::chrono::steady_clock::time_point m_timer_epoch = {};
+    std::mutex m_timer_mutex;
+    std::condition_variable m_timer_cv;
+    bool m_timer_stop = false;
+    thread_t m_timer_thread;
+
 #ifndef __cpp_lib_jthread
-    bool m_workers_running = false;
+    std::atomic<bool> m_workers_running = false;
 #endif
 };
 
@@ -0,0 +1,126 @@
+#pragma once
+#include "basic/thread.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace XH {
+
+// Queue-wait histogram bucket i counts waits below 2^i ns (and at least 2^(i-1) ns), the last
+// bucket also takes everything slower, about 9 minutes and up.
+inline constexpr std::size_t queue_wait_buckets = 40;
+
+// Counters of one worker at the time of a snapshot.
+struct worker_stats
+{
+    uint64_t tasks_executed = 0;
+    // Tasks taken from another worker's deque (work-stealing mode only).
+    uint64_t steals = 0;
+    // Times the worker ran out of work and went idle.
+    uint64_t waits = 0;
+    uint64_t busy_ns = 0;
+    uint64_t idle_ns = 0;
+    std::array<uint64_t, queue_wait_buckets> queue_wait_histogram = {};
+};
+
+// Returned by thread_pool::snapshot(). Counters are read without stopping the workers, so the
+// values of different workers may be a few tasks apart.
+struct pool_stats
+{
+    std::size_t queued_tasks = 0;
+    std::size_t idle_workers = 0;
+    std::vector<worker_stats> workers = {};
+
+    [[nodiscard]] uint64_t tasks_executed() const noexcept
+    {
+        uint64_t total = 0;
+        for (const worker_stats& worker : workers)
+            total += worker.tasks_executed;
+        return total;
+    }
+
+    // Upper bound in ns of the queue wait below which a @quantile (0..1] of all tasks started.
+    [[nodiscard]] uint64_t queue_wait_percentile(const double quantile) const noexcept
+    {
+        std::array<uint64_t, queue_wait_buckets> merged = {};
+        uint64_t total = 0;
+        for (const worker_stats& worker : workers)
+        {
+            for (std::size_t i = 0; i < queue_wait_buckets; ++i)
+            {
+                merged[i] += worker.queue_wait_histogram[i];
+                total += worker.queue_wait_histogram[i];
+            }
+        }
+        const double target = quantile * static_cast<double>(total);
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < queue_wait_buckets; ++i)
+        {
+            seen += merged[i];
+            if (seen != 0 && static_cast<double>(seen) >= target)
+                return uint64_t{1} << i;
+        }
+        return 0;
+    }
+};
+
+// A queued task plus the time it was queued, used as queue element when statistics are enabled.
+template <typename Task>
+struct timed_task
+{
+    timed_task() = default;
+
+    explicit timed_task(Task&& task) : task(std::move(task)), enqueued(std::chrono::steady_clock::now()) {}
+
+    Task task;
+    std::chrono::steady_clock::time_point enqueued = {};
+};
+
+// Live counters of one worker, on a cache line of their own. Only the owning worker writes them,
+// so updates are plain relaxed load/store pairs rather than locked read-modify-writes.
+struct alignas(cache_line_size) worker_counters
+{
+    static void add(std::atomic<uint64_t>& counter, const uint64_t value) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static uint64_t to_ns(const std::chrono::steady_clock::duration duration) noexcept
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    }
+
+    void record_queue_wait(const std::chrono::steady_clock::duration wait) noexcept
+    {
+        const std::size_t bucket = std::min<std::size_t>(std::bit_width(to_ns(wait)), queue_wait_buckets - 1);
+        add(queue_wait_histogram[bucket], 1);
+    }
+
+    [[nodiscard]] worker_stats snapshot() const noexcept
+    {
+        worker_stats stats;
+        stats.tasks_executed = tasks_executed.load(std::memory_order_relaxed);
+        stats.steals = steals.load(std::memory_order_relaxed);
+        stats.waits = waits.load(std::memory_order_relaxed);
+        stats.busy_ns = busy_ns.load(std::memory_order_relaxed);
+        stats.idle_ns = idle_ns.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < queue_wait_buckets; ++i)
+            stats.queue_wait_histogram[i] = queue_wait_histogram[i].load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    std::atomic<uint64_t> tasks_executed = 0;
+    std::atomic<uint64_t> steals = 0;
+    std::atomic<uint64_t> waits = 0;
+    std::atomic<uint64_t> busy_ns = 0;
+    std::atomic<uint64_t> idle_ns = 0;
+    std::array<std::atomic<uint64_t>, queue_wait_buckets> queue_wait_histogram = {};
+};
+} // namespace XH
@@ -0,0 +1,276 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace XH {
+
+template <typename Task>
+class timer_wheel;
+
+enum class timer_state : uint8_t
+{
+    armed,
+    cancelled,
+    // A one-shot timer whose callback has started.
+    fired,
+};
+
+// One pending timer. While armed, the wheel holds a reference through `self`, so a timer
+// nobody keeps a handle to still fires.
+template <typename Task>
+struct timer_node
+{
+    timer_node* prev = nullptr;
+    timer_node* next = nullptr;
+    // Head of the slot list the node sits in, so it can be unlinked without a lookup.
+    timer_node** slot = nullptr;
+    uint64_t expires = 0;
+    // Ticks between two runs, 0 for one-shot timers.
+    uint64_t period = 0;
+    std::shared_ptr<timer_node> self = nullptr;
+    std::atomic<timer_state> state = timer_state::armed;
+    Task callback;
+
+    // Called by the task that came due, right before running the callback. A one-shot timer
+    // claims its only run, so exactly one of the run and timer_handle::cancel() wins.
+    bool claim_run() noexcept
+    {
+        if (period != 0)
+            return state.load() == timer_state::armed;
+        timer_state expected = timer_state::armed;
+        return state.compare_exchange_strong(expected, timer_state::fired);
+    }
+};
+
+// Returned by schedule_after / schedule_every. Dropping it does not cancel the timer.
+template <typename Task>
+class timer_handle
+{
+public:
+    timer_handle() = default;
+
+    timer_handle(std::weak_ptr<timer_wheel<Task>> wheel, std::shared_ptr<timer_node<Task>> node) : m_wheel(std::move(wheel)), m_node(std::move(node)) {}
+
+    // Unlinks the timer in O(1). A run that came due but hasn't started is skipped; one already
+    // running is not interrupted, but a periodic timer won't be re-armed. Returns true if this
+    // call stopped a run, false if the timer was already cancelled or a one-shot timer already fired.
+    bool cancel() noexcept
+    {
+        timer_state expected = timer_state::armed;
+        if (!m_node || !m_node->state.compare_exchange_strong(expected, timer_state::cancelled))
+            return false;
+        if (const std::shared_ptr<timer_wheel<Task>> wheel = m_wheel.lock())
+            wheel->cancel(*m_node);
+        return true;
+    }
+
+    [[nodiscard]] bool cancelled() const noexcept
+    {
+        return m_node && m_node->state == timer_state::cancelled;
+    }
+
+private:
+    std::weak_ptr<timer_wheel<Task>> m_wheel;
+    std::shared_ptr<timer_node<Task>> m_node;
+};
+
+// Hierarchical timing wheel (Varghese & Lauck, as used by the Linux kernel).
+// Level 0 has 256 one-tick slots, each further level has 64 slots, each 64 times coarser, so five
+// levels cover 2^32 ticks (about 50 days at 1ms). Insert and cancel are O(1) list operations; a
+// timer is moved down one level each time the wheel below it wraps, so it is touched at most once
+// per level no matter how many timers are outstanding. Thread-safe.
+template <typename Task>
+class timer_wheel
+{
+public:
+    using node_t = timer_node<Task>;
+
+    static constexpr std::size_t levels = 5;
+    static constexpr uint64_t max_delay = (uint64_t{1} << 32) - 1;
+
+    timer_wheel() = default;
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    ~timer_wheel()
+    {
+        for (auto& level : m_slots)
+        {
+            for (node_t*& head : level)
+            {
+                while (head != nullptr)
+                {
+                    node_t* node = head;
+                    head = node->next;
+                    node->prev = node->next = nullptr;
+                    node->slot = nullptr;
+                    node->self.reset();
+                }
+            }
+        }
+    }
+
+    // Arms @node to fire @delay ticks after tick @now (at least one tick) and every @period ticks after.
+    // An empty wheel is not ticked, so it fast-forwards to @now first.
+    void add(std::shared_ptr<node_t> node, const uint64_t now, const uint64_t delay, const uint64_t period)
+    {
+        const std::scoped_lock lock(m_mutex);
+        if (m_size == 0)
+            m_now = std::max(m_now, now);
+        node_t& armed = *node;
+        armed.period = period;
+        armed.expires = std::max(now + std::min(delay, max_delay), m_now + 1);
+        armed.expires = std::min(armed.expires, m_now + max_delay);
+        armed.self = std::move(node);
+        link(armed);
+        ++m_size;
+    }
+
+    bool cancel(node_t& node)
+    {
+        const std::scoped_lock lock(m_mutex);
+        if (!node.self)
+            return false;
+        unlink(node);
+        --m_size;
+        node.self.reset();
+        return true;
+    }
+
+    // Moves the wheel forward to @tick and appends every timer that came due to @expired.
+    // Periodic timers are re-armed before they are returned.
+    void advance(const uint64_t tick, std::vector<std::shared_ptr<node_t>>& expired)
+    {
+        const std::scoped_lock lock(m_mutex);
+        while (m_now < tick)
+        {
+            if (m_size == 0)
+            {
+                m_now = tick;
+                break;
+            }
+            ++m_now;
+            if ((m_now & level0_mask) == 0)
+                cascade();
+
+            node_t* head = std::exchange(m_slots[0][m_now & level0_mask], nullptr);
+            while (head != nullptr)
+            {
+                node_t* node = head;
+                head = node->next;
+                node->prev = node->next = nullptr;
+                node->slot = nullptr;
+                if (node->period != 0)
+                {
+                    node->expires = m_now + node->period;
+                    expired.push_back(node->self);
+                    link(*node);
+                }
+                else
+                {
+                    expired.push_back(std::move(node->self));
+                    --m_size;
+                }
+            }
+        }
+    }
+
+    // Earliest tick the wheel has to be advanced to: the next occupied level-0 slot, or the next
+    // level-0 wrap, where coarser timers cascade down. Advancing to any earlier tick fires nothing.
+    // Only meaningful while size() > 0.
+    [[nodiscard]] uint64_t next_expiry() const
+    {
+        const std::scoped_lock lock(m_mutex);
+        const uint64_t wrap = (m_now | level0_mask) + 1;
+        for (uint64_t tick = m_now + 1; tick < wrap; ++tick)
+        {
+            if (m_slots[0][tick & level0_mask] != nullptr)
+                return tick;
+        }
+        return wrap;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] uint64_t now() const
+    {
+        const std::scoped_lock lock(m_mutex);
+        return m_now;
+    }
+
+private:
+    static constexpr uint64_t level0_bits = 8;
+    static constexpr uint64_t level_bits = 6;
+    static constexpr uint64_t level0_mask = (uint64_t{1} << level0_bits) - 1;
+    static constexpr uint64_t level_mask = (uint64_t{1} << level_bits) - 1;
+    static constexpr std::size_t slots_per_level = std::size_t{1} << level0_bits;
+
+    [[nodiscard]] static constexpr uint64_t shift(const std::size_t level) noexcept
+    {
+        return level == 0 ? 0 : level0_bits + (level - 1) * level_bits;
+    }
+
+    void link(node_t& node)
+    {
+        const uint64_t delta = node.expires - m_now;
+        std::size_t level = 0;
+        while (level + 1 < levels && delta >= (uint64_t{1} << shift(level + 1)))
+            ++level;
+        const std::size_t idx = static_cast<std::size_t>((node.expires >> shift(level)) & (level == 0 ? level0_mask : level_mask));
+
+        node_t*& head = m_slots[level][idx];
+        node.prev = nullptr;
+        node.next = head;
+        if (head != nullptr)
+            head->prev = &node;
+        head = &node;
+        node.slot = &head;
+    }
+
+    void unlink(node_t& node)
+    {
+        if (node.prev != nullptr)
+            node.prev->next = node.next;
+        else
+            *node.slot = node.next;
+        if (node.next != nullptr)
+            node.next->prev = node.prev;
+        node.prev = node.next = nullptr;
+        node.slot = nullptr;
+    }
+
+    // Level 0 just wrapped: pull the slot of each coarser level that is now current down into the
+    // finer levels. Higher levels go first, since their timers may land in the lower slot we drain next.
+    void cascade()
+    {
+        std::size_t top = 1;
+        while (top + 1 < levels && ((m_now >> shift(top)) & level_mask) == 0)
+            ++top;
+        for (std::size_t level = top; level >= 1; --level)
+        {
+            node_t* head = std::exchange(m_slots[level][(m_now >> shift(level)) & level_mask], nullptr);
+            while (head != nullptr)
+            {
+                node_t* node = head;
+                head = node->next;
+                link(*node);
+            }
+        }
+    }
+
+    std::array<std::array<node_t*, slots_per_level>, levels> m_slots = {};
+    std::atomic<std::size_t> m_size = 0;
+    uint64_t m_now = 0;
+    mutable std::mutex m_mutex;
+};
+} // namespace XH
@@ -0,0 +1,66 @@
+#pragma once
+#include "basic/ring_buffer.h"
+#include "basic/thread.h"
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+namespace XH {
+
+// Per-worker task deque used by the work-stealing pool.
+// The owning worker pushes and pops at the back (LIFO keeps freshly spawned work hot in cache),
+// thieves take from the front so they grab the oldest, usually largest, pieces of work.
+// Every end is guarded by a tiny per-queue lock: it is almost always uncontended since thieves
+// only show up when they are idle, and unlike a Chase-Lev array it works for non-trivial task types.
+template <typename T>
+class alignas(cache_line_size) work_steal_queue
+{
+public:
+    void push(T&& item)
+    {
+        const std::scoped_lock lock(m_mutex);
+        m_items.push(std::move(item));
+    }
+
+    // Moves @count items starting at @first in under one lock acquisition.
+    template <typename It>
+    void push_bulk(It first, const std::size_t count)
+    {
+        const std::scoped_lock lock(m_mutex);
+        for (std::size_t i = 0; i < count; ++i, ++first)
+            m_items.push(T(std::move(*first)));
+    }
+
+    // Owner side: take the most recently pushed item.
+    [[nodiscard]] bool pop(T& out)
+    {
+        const std::scoped_lock lock(m_mutex);
+        if (m_items.empty())
+            return false;
+        out = std::move(m_items.back());
+        m_items.pop_back();
+        return true;
+    }
+
+    // Thief side: take the oldest item, give up immediately if the queue is busy.
+    [[nodiscard]] bool steal(T& out)
+    {
+        std::unique_lock lock(m_mutex, std::try_to_lock);
+        if (!lock.owns_lock() || m_items.empty())
+            return false;
+        out = std::move(m_items.front());
+        m_items.pop();
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        const std::scoped_lock lock(m_mutex);
+        return m_items.size();
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    ring_buffer<T> m_items;
+};
+} // namespace XH
@@ -0,0 +1,82 @@
+#ifndef EVENT_COUNT_H
+#define EVENT_COUNT_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+
+// 无锁队列的阻塞等待：没有等待者时Notify只有一次原子读，不碰锁。
+// 等待方用法：
+//   auto key = ec.PrepareWait();
+//   if (条件已满足) { ec.CancelWait(); ... } else { ec.Wait(key); }
+// 通知方在条件变化（比如数据入队）之后调用NotifyOne/NotifyAll。
+class EventCount {
+public:
+    uint64_t PrepareWait();
+    void CancelWait();
+
+    void Wait(uint64_t key);
+    // 超时返回false
+    bool WaitUntil(uint64_t key, std::chrono::steady_clock::time_point deadline);
+
+    void NotifyOne();
+    void NotifyAll();
+
+private:
+    void Notify(bool all);
+
+private:
+    std::atomic<uint64_t> m_epoch{0};
+    std::atomic<uint32_t> m_waiters{0};
+    std::mutex m_mut;
+    std::condition_variable m_cv;
+};
+
+inline uint64_t EventCount::PrepareWait() {
+    // seq_cst与Notify中的读m_waiters配对：要么通知方看到等待者，要么等待方看到新数据
+    m_waiters.fetch_add(1, std::memory_order_seq_cst);
+    return m_epoch.load(std::memory_order_seq_cst);
+}
+
+inline void EventCount::CancelWait() {
+    m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+inline void EventCount::Wait(uint64_t key) {
+    std::unique_lock<std::mutex> lk(m_mut);
+    m_cv.wait(lk, [this, key]() { return m_epoch.load(std::memory_order_relaxed) != key; });
+    m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+inline bool EventCount::WaitUntil(uint64_t key, std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lk(m_mut);
+    bool notified = m_cv.wait_until(lk, deadline, [this, key]() { return m_epoch.load(std::memory_order_relaxed) != key; });
+    m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return notified;
+}
+
+inline void EventCount::NotifyOne() {
+    Notify(false);
+}
+
+inline void EventCount::NotifyAll() {
+    Notify(true);
+}
+
+inline void EventCount::Notify(bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiters.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_mut);
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    }
+    if (all) {
+        m_cv.notify_all();
+    } else {
+        m_cv.notify_one();
+    }
+}
+#endif
@@ -0,0 +1,196 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "event_count.h"
+
+// 有界无锁多生产者多消费者队列（Dmitry Vyukov的环形队列）。
+// 每个槽带一个序号，生产者/消费者各自CAS抢位置后只写自己的槽，入队出队互不加锁；
+// 队头队尾各占一个cache line，避免生产者和消费者互相踢cache line。
+// 接口语义同ThreadSafeQueue，区别是容量固定：Push在队满时阻塞，TryPush队满时返回false。
+template<class T>
+class MpmcQueue {
+public:
+    // @capacity: 向上取整为2的幂
+    explicit MpmcQueue(size_t capacity = 1024);
+
+    // 使用者保证销毁前无人访问
+    ~MpmcQueue();
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // 队满时阻塞直到有空位
+    void Push(T elem);
+    bool TryPush(T elem);
+
+    // 尝试获取队列中数据
+    // @ms: <0-阻塞直到数据产生；=0-立即返回；>0-阻塞直到数据产生或者等待ms毫秒
+    std::optional<T> Pop(int32_t ms = 0);
+    std::optional<T> TryPop();
+
+    // 并发下只是近似值
+    size_t Size() const;
+    size_t Capacity() const;
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    bool Enqueue(T& elem);
+    bool Dequeue(std::optional<T>& out);
+
+private:
+    size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    alignas(CACHE_LINE) std::atomic<size_t> m_enqueuePos{0};
+    alignas(CACHE_LINE) std::atomic<size_t> m_dequeuePos{0};
+    alignas(CACHE_LINE) EventCount m_notEmpty;
+    EventCount m_notFull;
+};
+
+template<typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity) {
+    size_t cap = 2;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+    m_mask = cap - 1;
+    m_cells = std::make_unique<Cell[]>(cap);
+    for (size_t i = 0; i < cap; ++i) {
+        m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+MpmcQueue<T>::~MpmcQueue() {
+    while (TryPop()) {
+    }
+}
+
+template<typename T>
+bool MpmcQueue<T>::Enqueue(T& elem) {
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                ::new (cell.storage) T(std::move(elem));
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // 槽还没被上一轮消费，队满
+            return false;
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool MpmcQueue<T>::Dequeue(std::optional<T>& out) {
+    size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                T* elem = std::launder(reinterpret_cast<T*>(cell.storage));
+                out.emplace(std::move(*elem));
+                elem->~T();
+                cell.seq.store(pos + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // 槽还没被生产者写入，队空
+            return false;
+        } else {
+            pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool MpmcQueue<T>::TryPush(T elem) {
+    if (!Enqueue(elem)) {
+        return false;
+    }
+    m_notEmpty.NotifyOne();
+    return true;
+}
+
+template<typename T>
+void MpmcQueue<T>::Push(T elem) {
+    while (!Enqueue(elem)) {
+        uint64_t key = m_notFull.PrepareWait();
+        if (Enqueue(elem)) {
+            m_notFull.CancelWait();
+            break;
+        }
+        m_notFull.Wait(key);
+    }
+    m_notEmpty.NotifyOne();
+}
+
+template<typename T>
+std::optional<T> MpmcQueue<T>::TryPop() {
+    std::optional<T> res;
+    if (Dequeue(res)) {
+        m_notFull.NotifyOne();
+    }
+    return res;
+}
+
+template<typename T>
+std::optional<T> MpmcQueue<T>::Pop(int32_t ms) {
+    std::optional<T> res = TryPop();
+    if (res || ms == 0) {
+        return res;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (true) {
+        uint64_t key = m_notEmpty.PrepareWait();
+        res = TryPop();
+        if (res) {
+            m_notEmpty.CancelWait();
+            return res;
+        }
+        if (ms < 0) {
+            m_notEmpty.Wait(key);
+        } else if (!m_notEmpty.WaitUntil(key, deadline)) {
+            return TryPop();
+        }
+        res = TryPop();
+        if (res) {
+            return res;
+        }
+    }
+}
+
+template<typename T>
+size_t MpmcQueue<T>::Size() const {
+    size_t tail = m_enqueuePos.load(std::memory_order_relaxed);
+    size_t head = m_dequeuePos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
+
+template<typename T>
+size_t MpmcQueue<T>::Capacity() const {
+    return m_mask + 1;
+}
+#endif
@@ -0,0 +1,142 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stddef.h>
+#include <utility>
+
+// 单生产者单消费者环形队列，只能有一个线程Push、一个线程Pop。
+// 生产者只写m_tail，消费者只写m_head，各占一个cache line；双方各自缓存一份对方的下标，
+// 只有缓存值显示队满/队空时才去读对方的cache line，稳定状态下几乎没有跨核流量。
+// TryPush/TryPop都是wait-free的，队满/队空直接返回。
+template<class T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue();
+
+    // 使用者保证销毁前无人访问
+    ~SpscQueue();
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 生产者调用，队满返回false且元素留在调用方
+    bool TryPush(T&& elem);
+    bool TryPush(const T& elem);
+    template<class... Args>
+    bool TryEmplace(Args&&... args);
+
+    // 消费者调用
+    std::optional<T> TryPop();
+    // 消费者调用，取队头但不出队，队空返回nullptr
+    T* Front();
+    // 消费者调用，丢掉Front()返回的元素
+    void PopFront();
+
+    // 并发下只是近似值
+    size_t Size() const;
+    bool Empty() const;
+    static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t MASK = Capacity - 1;
+
+    T* At(size_t idx) { return std::launder(reinterpret_cast<T*>(m_slots[idx & MASK].storage)); }
+
+private:
+    std::unique_ptr<Slot[]> m_slots;
+    // 消费者侧
+    alignas(CACHE_LINE) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    // 生产者侧
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0;
+};
+
+template<typename T, size_t Capacity>
+SpscQueue<T, Capacity>::SpscQueue() : m_slots(std::make_unique<Slot[]>(Capacity)) {
+}
+
+template<typename T, size_t Capacity>
+SpscQueue<T, Capacity>::~SpscQueue() {
+    while (Front() != nullptr) {
+        PopFront();
+    }
+}
+
+template<typename T, size_t Capacity>
+template<class... Args>
+bool SpscQueue<T, Capacity>::TryEmplace(Args&&... args) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cachedHead == Capacity) {
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+        if (tail - m_cachedHead == Capacity) {
+            return false;
+        }
+    }
+    ::new (m_slots[tail & MASK].storage) T(std::forward<Args>(args)...);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::TryPush(T&& elem) {
+    return TryEmplace(std::move(elem));
+}
+
+template<typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::TryPush(const T& elem) {
+    return TryEmplace(elem);
+}
+
+template<typename T, size_t Capacity>
+T* SpscQueue<T, Capacity>::Front() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cachedTail) {
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if (head == m_cachedTail) {
+            return nullptr;
+        }
+    }
+    return At(head);
+}
+
+template<typename T, size_t Capacity>
+void SpscQueue<T, Capacity>::PopFront() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    At(head)->~T();
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+template<typename T, size_t Capacity>
+std::optional<T> SpscQueue<T, Capacity>::TryPop() {
+    T* front = Front();
+    if (front == nullptr) {
+        return std::nullopt;
+    }
+    std::optional<T> res(std::move(*front));
+    PopFront();
+    return res;
+}
+
+template<typename T, size_t Capacity>
+size_t SpscQueue<T, Capacity>::Size() const {
+    size_t head = m_head.load(std::memory_order_acquire);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+}
+
+template<typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::Empty() const {
+    return Size() == 0;
+}
+#endif
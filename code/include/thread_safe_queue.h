@@ -1,55 +1,227 @@
 #ifndef THREAD_SAFE_QUEUE_H
 #define THREAD_SAFE_QUEUE_H
+#include <atomic>
 #include <optional>
 #include <mutex>
 #include <queue>
 #include <chrono>
 #include <condition_variable>
+#include <span>
+#include <stddef.h>
 #include <stdint.h>
+#include <utility>
+
+// 有界队列满时Push的处理方式
+enum class OverflowPolicy {
+    Block,       // 阻塞生产者直到有空位
+    Fail,        // 立即返回false，元素留在调用方
+    DropNewest,  // 丢弃新元素，计入丢弃数
+    DropOldest,  // 丢弃队头最老的元素腾出位置，计入丢弃数
+};
 
 template<class T>
 class ThreadSafeQueue {
 public:
+    // 无界队列
     ThreadSafeQueue() = default;
-    
+
+    // @capacity: 0-无界
+    explicit ThreadSafeQueue(size_t capacity, OverflowPolicy policy = OverflowPolicy::Block);
+
     ThreadSafeQueue(ThreadSafeQueue&& other);
 
     // 使用者保证销毁前无人访问
     ~ThreadSafeQueue() = default;
 
-    void Push(T elem);
+    // 修改容量和溢出策略，不影响已在队列中的元素；
+    // 缩小后超出的部分留给消费者取走，DropOldest策略下下一次Push会把它们一并丢掉
+    void SetCapacity(size_t capacity, OverflowPolicy policy = OverflowPolicy::Block);
+
+    // 返回元素是否入队，有界队列满时的行为见OverflowPolicy
+    bool Push(const T& elem);
+    bool Push(T&& elem);
+
+    // 在队列中原地构造
+    template<class... Args>
+    bool Emplace(Args&&... args);
+
+    // 不论策略，队满时都立即返回false，元素留在调用方
+    bool TryPush(const T& elem);
+    bool TryPush(T&& elem);
+
+    // 一次加锁压入全部元素，入队的元素会被move走，返回入队个数
+    size_t PushBulk(std::span<T> elems);
 
     // 尝试获取队列中数据
     // @ms: <0-阻塞直到数据产生；=0-立即返回；>0-阻塞直到数据产生或者等待ms毫秒
     std::optional<T> Pop(int32_t ms = 0);
 
+    // 等待语义同Pop，有数据后一次加锁取出最多max个写到out，返回取出的个数
+    template<class OutIt>
+    size_t PopBulk(OutIt out, size_t max, int32_t ms = 0);
+
     size_t Size();
+    // 不加锁的近似值，适合频繁检查
+    size_t SizeHint() const;
+    size_t Capacity();
+
+    // DropNewest/DropOldest策略下累计丢弃的元素个数
+    uint64_t Dropped() const;
 
 private:
     std::optional<T> PopUntilHasVal();
     std::optional<T> PopFor(uint32_t ms);
+    // 按ms等到队列非空，超时返回false
+    bool WaitNotEmpty(std::unique_lock<std::mutex>& lk, int32_t ms);
+
+    // 持锁调用，按策略处理队满后入队
+    template<class... Args>
+    bool PushLocked(std::unique_lock<std::mutex>& lk, bool tryOnly, Args&&... args);
+    template<class... Args>
+    bool PushOne(bool tryOnly, Args&&... args);
+    // 持锁调用，取走队头后唤醒等待空位的生产者
+    T TakeFrontLocked();
 
 private:
     std::mutex m_mut;
     std::queue<T> m_data;
     std::condition_variable m_cv;
+    std::condition_variable m_notFull;
+    size_t m_capacity = 0;
+    OverflowPolicy m_policy = OverflowPolicy::Block;
+    std::atomic<size_t> m_size{0};
+    std::atomic<uint64_t> m_dropped{0};
 };
 
+template<typename T>
+ThreadSafeQueue<T>::ThreadSafeQueue(size_t capacity, OverflowPolicy policy)
+    : m_capacity(capacity), m_policy(policy) {
+}
+
 template<typename T>
 ThreadSafeQueue<T>::ThreadSafeQueue(ThreadSafeQueue&& other) {
     std::lock_guard<std::mutex> lk(other.m_mut);
     m_data = std::move(other.m_data);
+    m_capacity = other.m_capacity;
+    m_policy = other.m_policy;
+    m_size = m_data.size();
+    m_dropped = other.m_dropped.load();
+}
+
+template<typename T>
+void ThreadSafeQueue<T>::SetCapacity(size_t capacity, OverflowPolicy policy) {
+    {
+        std::lock_guard<std::mutex> lk(m_mut);
+        m_capacity = capacity;
+        m_policy = policy;
+    }
+    m_notFull.notify_all();
+}
+
+template<typename T>
+template<class... Args>
+bool ThreadSafeQueue<T>::PushLocked(std::unique_lock<std::mutex>& lk, bool tryOnly, Args&&... args) {
+    auto hasRoom = [this]() { return m_capacity == 0 || m_data.size() < m_capacity; };
+    if (!hasRoom()) {
+        if (tryOnly) {
+            return false;
+        }
+        switch (m_policy) {
+            case OverflowPolicy::Block:
+                // 批量入队时前面的元素已经进队，先叫醒消费者再等
+                m_cv.notify_all();
+                m_notFull.wait(lk, hasRoom);
+                break;
+            case OverflowPolicy::Fail:
+                return false;
+            case OverflowPolicy::DropNewest:
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            case OverflowPolicy::DropOldest: {
+                // SetCapacity缩小后可能超出不止一个
+                uint64_t n = 0;
+                for (; !hasRoom(); ++n) {
+                    m_data.pop();
+                }
+                m_dropped.fetch_add(n, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+    m_data.emplace(std::forward<Args>(args)...);
+    m_size.store(m_data.size(), std::memory_order_relaxed);
+    return true;
 }
 
 template<typename T>
-void ThreadSafeQueue<T>::Push(T elem) {
-    std::lock_guard<std::mutex> lk(m_mut);
-    m_data.push(elem);
+template<class... Args>
+bool ThreadSafeQueue<T>::PushOne(bool tryOnly, Args&&... args) {
+    std::unique_lock<std::mutex> lk(m_mut);
+    if (!PushLocked(lk, tryOnly, std::forward<Args>(args)...)) {
+        return false;
+    }
+    lk.unlock();
     m_cv.notify_one();
+    return true;
+}
+
+template<typename T>
+bool ThreadSafeQueue<T>::Push(const T& elem) {
+    return PushOne(false, elem);
 }
 
 template<typename T>
-std::optional<T> ThreadSafeQueue<T>::Pop(int32_t ms) 
+bool ThreadSafeQueue<T>::Push(T&& elem) {
+    return PushOne(false, std::move(elem));
+}
+
+template<typename T>
+template<class... Args>
+bool ThreadSafeQueue<T>::Emplace(Args&&... args) {
+    return PushOne(false, std::forward<Args>(args)...);
+}
+
+template<typename T>
+bool ThreadSafeQueue<T>::TryPush(const T& elem) {
+    return PushOne(true, elem);
+}
+
+template<typename T>
+bool ThreadSafeQueue<T>::TryPush(T&& elem) {
+    return PushOne(true, std::move(elem));
+}
+
+template<typename T>
+size_t ThreadSafeQueue<T>::PushBulk(std::span<T> elems) {
+    size_t pushed = 0;
+    {
+        std::unique_lock<std::mutex> lk(m_mut);
+        for (T& elem : elems) {
+            pushed += PushLocked(lk, false, std::move(elem));
+        }
+    }
+    if (pushed == 1) {
+        m_cv.notify_one();
+    } else if (pushed > 1) {
+        m_cv.notify_all();
+    }
+    return pushed;
+}
+
+template<typename T>
+T ThreadSafeQueue<T>::TakeFrontLocked()
+{
+    T res(std::move(m_data.front()));
+    m_data.pop();
+    m_size.store(m_data.size(), std::memory_order_relaxed);
+    if (m_capacity != 0) {
+        m_notFull.notify_one();
+    }
+    return res;
+}
+
+template<typename T>
+std::optional<T> ThreadSafeQueue<T>::Pop(int32_t ms)
 {
     if (ms < 0) {
         return PopUntilHasVal();
@@ -63,10 +235,7 @@ std::optional<T> ThreadSafeQueue<T>::PopUntilHasVal()
 {
     std::unique_lock<std::mutex> lk(m_mut);
     m_cv.wait(lk, [this]() { return !m_data.empty(); });
-    auto res(std::move(m_data.front()));
-    m_data.pop();
-    return res;
-
+    return TakeFrontLocked();
 }
 
 template<typename T>
@@ -74,18 +243,67 @@ std::optional<T> ThreadSafeQueue<T>::PopFor(uint32_t ms)
 {
     std::unique_lock<std::mutex> lk(m_mut);
     if (m_cv.wait_for(lk, std::chrono::milliseconds(ms), [this]() { return !m_data.empty(); })) {
-        auto res(std::move(m_data.front()));
-        m_data.pop();
-        return res;
+        return TakeFrontLocked();
     } else {
         return std::nullopt;
     }
 }
 
+template<typename T>
+bool ThreadSafeQueue<T>::WaitNotEmpty(std::unique_lock<std::mutex>& lk, int32_t ms)
+{
+    auto notEmpty = [this]() { return !m_data.empty(); };
+    if (ms < 0) {
+        m_cv.wait(lk, notEmpty);
+        return true;
+    }
+    return m_cv.wait_for(lk, std::chrono::milliseconds(ms), notEmpty);
+}
+
+template<typename T>
+template<class OutIt>
+size_t ThreadSafeQueue<T>::PopBulk(OutIt out, size_t max, int32_t ms)
+{
+    std::unique_lock<std::mutex> lk(m_mut);
+    if (max == 0 || !WaitNotEmpty(lk, ms)) {
+        return 0;
+    }
+    size_t n = 0;
+    for (; n < max && !m_data.empty(); ++n) {
+        *out = std::move(m_data.front());
+        ++out;
+        m_data.pop();
+    }
+    m_size.store(m_data.size(), std::memory_order_relaxed);
+    if (m_capacity != 0) {
+        m_notFull.notify_all();
+    }
+    return n;
+}
+
 template<typename T>
 size_t ThreadSafeQueue<T>::Size()
 {
     std::unique_lock<std::mutex> lk(m_mut);
     return m_data.size();
 }
-#endif
\ No newline at end of file
+
+template<typename T>
+size_t ThreadSafeQueue<T>::SizeHint() const
+{
+    return m_size.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+size_t ThreadSafeQueue<T>::Capacity()
+{
+    std::unique_lock<std::mutex> lk(m_mut);
+    return m_capacity;
+}
+
+template<typename T>
+uint64_t ThreadSafeQueue<T>::Dropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+#endif
@@ -1,12 +1,139 @@
 #include "basic/mail_box.h"
 #include <arpa/inet.h>
+#include <algorithm>
 #include <cassert>
+#include <new>
 
 namespace XH {
-mail_box::mail_box() noexcept
+void msg_buf_deleter::operator()(msg_buf* msg) const noexcept
+{
+    msg->pool->release(msg);
+}
+
+msg_pool* msg_pool::create(size_t slot_size, size_t slab_slots) noexcept
+{
+    try
+    {
+        return new msg_pool(slot_size, slab_slots);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+msg_pool::msg_pool(size_t slot_size, size_t slab_slots) noexcept
+    : m_slot_size(std::max<size_t>(slot_size, 1))
+    , m_slab_slots(std::max<size_t>(slab_slots, 1))
 {}
+
+msg_ptr msg_pool::acquire() noexcept
+{
+    msg_buf* msg = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.empty() && !grow())
+        {
+            return msg_ptr{};
+        }
+        msg = m_free.back();
+        m_free.pop_back();
+        ++m_in_use;
+        ++m_acquired;
+    }
+    msg->buf = std::span<uint8_t>(msg->slot, m_slot_size);
+    return msg_ptr(msg);
+}
+
+void msg_pool::release(msg_buf* msg) noexcept
+{
+    // Free reassembled storage outside the lock
+    std::vector<uint8_t>().swap(msg->reassembled);
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Capacity was reserved in grow(), never allocates
+        m_free.push_back(msg);
+        --m_in_use;
+        last = m_closed && m_in_use == 0;
+    }
+    if (last)
+    {
+        delete this;
+    }
+}
+
+void msg_pool::close() noexcept
+{
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        last = m_in_use == 0;
+    }
+    if (last)
+    {
+        delete this;
+    }
+}
+
+msg_pool::stats msg_pool::get_stats() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return stats{m_allocations, m_acquired, m_headers.size() * m_slab_slots, m_in_use};
+}
+
+bool msg_pool::grow() noexcept
+{
+    try
+    {
+        auto headers = std::make_unique<msg_buf[]>(m_slab_slots);
+        auto storage = std::make_unique<uint8_t[]>(m_slab_slots * m_slot_size);
+        m_allocations += 2;
+        m_free.reserve((m_headers.size() + 1) * m_slab_slots);
+        m_headers.reserve(m_headers.size() + 1);
+        m_storage.reserve(m_storage.size() + 1);
+        for (size_t i = 0; i < m_slab_slots; ++i)
+        {
+            headers[i].slot = storage.get() + i * m_slot_size;
+            headers[i].pool = this;
+            m_free.push_back(&headers[i]);
+        }
+        m_headers.push_back(std::move(headers));
+        m_storage.push_back(std::move(storage));
+        return true;
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+}
+
+mail_box::mail_box(size_t batch_size, size_t max_msg_size) noexcept
+    : m_batch_size(std::max<size_t>(batch_size, 1))
+    , m_pool(msg_pool::create(std::clamp<size_t>(max_msg_size, 1, MAX_DATAGRAM_SIZE), std::max(POOL_SLAB_SLOTS, m_batch_size)))
+    , m_slots(m_batch_size)
+    , m_msgs(m_batch_size)
+    , m_iovs(m_batch_size)
+    , m_addrs(m_batch_size)
+    , m_views(m_batch_size)
+{
+    // A failed pool allocation leaves m_pool null: bind() refuses and onRead() reads nothing
+    for (size_t i = 0; i < m_batch_size; ++i)
+    {
+        m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+        m_msgs[i].msg_hdr.msg_name = &m_addrs[i];
+    }
+}
 mail_box::~mail_box() noexcept
 {
+    // Messages still held by handlers keep the pool alive
+    m_slots.clear();
+    if (m_pool)
+    {
+        m_pool->close();
+    }
     if (m_mail_event)
     {
         event_free(m_mail_event);
@@ -20,6 +147,10 @@ mail_box::~mail_box() noexcept
 
 int mail_box::bind(const std::string& ip, int port) noexcept
 {
+    if (!m_pool)
+    {
+        return -1;
+    }
     m_fd = socket(AF_INET, SOCK_DGRAM, 0);
     if (m_fd < 0)
     {
@@ -46,27 +177,268 @@ void mail_box::regist_handler(HandlerT&& handler) noexcept
     m_handler = std::move(handler);
 }
 
+void mail_box::regist_batch_handler(BatchHandlerT&& handler) noexcept
+{
+    m_batch_handler = std::move(handler);
+}
+
+void mail_box::enable_reassembly(const reassembly_options& options) noexcept
+{
+    m_reassemble = true;
+    m_reassembly = options;
+    m_reassembly.max_pending = std::max<size_t>(m_reassembly.max_pending, 1);
+}
+
 void mail_box::onRead(evutil_socket_t fd, short events, void* arg) noexcept
 {
     mail_box* o = reinterpret_cast<mail_box*>(arg);
     assert(o != nullptr);
 
-    auto msg = std::make_unique<msg_buf>();
+    // Drain the socket a batch at a time, but leave the rest to the next callback after a while
+    // so one busy socket can't starve the other events
+    for (int round = 0; round < MAX_BATCHES_PER_READ && o->m_mail_event != nullptr; ++round)
+    {
+        size_t slots = o->refill();
+        if (slots == 0)
+        {
+            LOG_WARN("no memory for message buffers");
+            return;
+        }
+        for (size_t i = 0; i < slots; ++i)
+        {
+            o->m_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+        int received = recvmmsg(fd, o->m_msgs.data(), slots, MSG_DONTWAIT, nullptr);
+        if (received < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_WARN("recv from socket failed: {}", strerror(errno));
+            }
+            return;
+        }
 
-    msg->buf.resize(MAX_MSG_SIZE);
-    socklen_t addr_len = sizeof(msg->src_addr);
+        o->dispatch(received);
+        if (static_cast<size_t>(received) < slots)
+        {
+            return;
+        }
+    }
+}
 
-    int received_bytes = recvfrom(fd, reinterpret_cast<void*>(msg->buf.data()), msg->buf.size() - 1, 0, (struct sockaddr*)&(msg->src_addr), &addr_len);
-    if (received_bytes < 0)
+size_t mail_box::refill() noexcept
+{
+    // Fill the slots handed out by the last batch, the filled ones up to the returned count are usable
+    if (!m_pool)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < m_batch_size; ++i)
     {
-        LOG_WARN("recv from socket failed: %s", strerror(errno));
+        if (!m_slots[i])
+        {
+            m_slots[i] = m_pool->acquire();
+            if (!m_slots[i])
+            {
+                return i;
+            }
+            m_iovs[i].iov_base = m_slots[i]->slot;
+            m_iovs[i].iov_len = m_pool->slot_size();
+        }
+    }
+    return m_batch_size;
+}
+
+void mail_box::dispatch(size_t count) noexcept
+{
+    if (!m_pending.empty())
+    {
+        expire_pending();
+    }
+
+    if (m_batch_handler)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::span<uint8_t> payload;
+            if (unwrap(i, payload))
+            {
+                m_views[n].src_addr = m_addrs[i];
+                m_views[n].buf = payload;
+                ++n;
+            }
+        }
+        // The slots stay with the mail_box and are reused by the next call
+        if (n > 0)
+        {
+            m_batch_handler(this, std::span<const msg_view>(m_views.data(), n));
+        }
+        m_completed.clear();
         return;
     }
 
-    msg->buf.resize(received_bytes);
+    // Every message read is delivered, even if the handler removes the event halfway
+    for (size_t i = 0; i < count && m_handler; ++i)
+    {
+        std::span<uint8_t> payload;
+        if (!unwrap(i, payload))
+        {
+            continue;
+        }
+
+        msg_ptr msg;
+        if (!m_completed.empty())
+        {
+            // Reassembled message, the slot of its last fragment stays for the next batch
+            msg = m_pool->acquire();
+            if (!msg)
+            {
+                m_completed.clear();
+                ++m_reassembly_dropped;
+                continue;
+            }
+            msg->reassembled = std::move(m_completed.back());
+            m_completed.clear();
+            payload = msg->reassembled;
+        }
+        else
+        {
+            msg = std::move(m_slots[i]);
+        }
+        msg->src_addr = m_addrs[i];
+        msg->buf = payload;
 
-    // Call the user-registered handler
-    o->m_handler(o, std::move(msg));
+        // Call the user-registered handler
+        m_handler(this, std::move(msg));
+    }
+}
+
+bool mail_box::unwrap(size_t i, std::span<uint8_t>& payload) noexcept
+{
+    uint8_t* data = m_slots[i]->slot;
+    size_t len = m_msgs[i].msg_len;
+    if (m_msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+    {
+        // Log at 1, 2, 4, 8... so a flood of them doesn't flood the log too
+        const uint64_t n = ++m_truncated;
+        if ((n & (n - 1)) == 0)
+        {
+            LOG_WARN("dropped {} datagrams larger than {} bytes", n, m_pool->slot_size());
+        }
+        return false;
+    }
+
+    payload = std::span<uint8_t>(data, len);
+    frag_header h;
+    if (!m_reassemble || len < sizeof(h))
+    {
+        return true;
+    }
+    memcpy(&h, data, sizeof(h));
+    if (ntohl(h.magic) != frag_header::FRAG_MAGIC)
+    {
+        return true;
+    }
+
+    const uint32_t msg_id = ntohl(h.msg_id);
+    const uint32_t total = ntohl(h.total_len);
+    const uint32_t offset = ntohl(h.offset);
+    const uint16_t index = ntohs(h.index);
+    const uint16_t frags = ntohs(h.count);
+    const size_t frag_len = len - sizeof(h);
+    if (index >= frags || total > m_reassembly.max_msg_size || offset > total || frag_len > total - offset)
+    {
+        ++m_reassembly_dropped;
+        return false;
+    }
+    if (frags == 1)
+    {
+        if (offset != 0 || frag_len != total)
+        {
+            ++m_reassembly_dropped;
+            return false;
+        }
+        // Whole message in one datagram, deliver it from the slot
+        payload = std::span<uint8_t>(data + sizeof(h), frag_len);
+        return true;
+    }
+
+    // Fragments are laid out back to back: fragment k starts at k * chunk and all but the last
+    // are exactly chunk long, so distinct indexes of one message can't overlap or leave gaps
+    uint64_t chunk = 0;
+    bool laid_out = frag_len > 0;
+    if (index + 1 < frags)
+    {
+        chunk = frag_len;
+        laid_out = laid_out && offset == index * chunk;
+    }
+    else
+    {
+        chunk = offset / (frags - 1);
+        laid_out = laid_out && offset % (frags - 1) == 0 && frag_len <= chunk && offset + frag_len == total;
+    }
+    if (!laid_out)
+    {
+        ++m_reassembly_dropped;
+        return false;
+    }
+
+    const sockaddr_in& src = m_addrs[i];
+    auto it = std::find_if(m_pending.begin(), m_pending.end(), [&](const pending_msg& p) {
+        return p.msg_id == msg_id && p.src_addr.sin_addr.s_addr == src.sin_addr.s_addr && p.src_addr.sin_port == src.sin_port;
+    });
+    try
+    {
+        if (it == m_pending.end())
+        {
+            if (m_pending.size() >= m_reassembly.max_pending)
+            {
+                // Entries are appended in arrival order, the front is the oldest
+                m_pending.erase(m_pending.begin());
+                ++m_reassembly_dropped;
+            }
+            m_pending.push_back(pending_msg{src, msg_id, static_cast<uint32_t>(chunk), 0, std::vector<bool>(frags),
+                                            std::vector<uint8_t>(total), std::chrono::steady_clock::now()});
+            it = m_pending.end() - 1;
+        }
+        else if (it->got.size() != frags || it->data.size() != total || it->chunk != chunk)
+        {
+            m_pending.erase(it);
+            ++m_reassembly_dropped;
+            return false;
+        }
+
+        if (!it->got[index])
+        {
+            memcpy(it->data.data() + offset, data + sizeof(h), frag_len);
+            it->got[index] = true;
+            ++it->received;
+        }
+        if (it->received < frags)
+        {
+            return false;
+        }
+        m_completed.push_back(std::move(it->data));
+    }
+    catch (const std::bad_alloc&)
+    {
+        ++m_reassembly_dropped;
+        return false;
+    }
+    m_pending.erase(it);
+    payload = m_completed.back();
+    return true;
+}
+
+void mail_box::expire_pending() noexcept
+{
+    const auto deadline = std::chrono::steady_clock::now() - m_reassembly.timeout;
+    auto expired = std::remove_if(m_pending.begin(), m_pending.end(), [deadline](const pending_msg& p) {
+        return p.first_seen < deadline;
+    });
+    m_reassembly_dropped += m_pending.end() - expired;
+    m_pending.erase(expired, m_pending.end());
 }
 
 void mail_box::add_event(struct event_base* base) noexcept
@@ -115,16 +487,62 @@ void mail_sender::set_dst(const std::string& ip, int port) noexcept
         m_fd = socket(AF_INET, SOCK_DGRAM, 0);
         if (m_fd < 0)
         {
-            LOG_ERROR("Failed to create socket: %s", strerror(errno));
+            LOG_ERROR("Failed to create socket: {}", strerror(errno));
             return;
         }
         evutil_make_socket_nonblocking(m_fd);
     }
 }
 
-int mail_sender::send(const std::string& ip, int port, std::span<uint8_t> data) noexcept
+int mail_sender::send(const std::string& ip, int port, std::span<const uint8_t> data) noexcept
 {
     set_dst(ip, port);
     return sendto(m_fd, data.data(), data.size(), 0, (struct sockaddr*)&m_addr, sizeof(m_addr));
 }
+
+int mail_sender::send_fragmented(const std::string& ip, int port, std::span<const uint8_t> data, size_t max_datagram) noexcept
+{
+    set_dst(ip, port);
+    max_datagram = std::min(max_datagram, MAX_DATAGRAM_SIZE);
+    if (m_fd < 0 || max_datagram <= sizeof(frag_header) || data.size() > INT32_MAX)
+    {
+        return -1;
+    }
+    const size_t chunk = max_datagram - sizeof(frag_header);
+    const size_t frags = std::max<size_t>((data.size() + chunk - 1) / chunk, 1);
+    if (frags > UINT16_MAX)
+    {
+        return -1;
+    }
+
+    frag_header h{};
+    h.magic = htonl(frag_header::FRAG_MAGIC);
+    h.msg_id = htonl(m_next_msg_id++);
+    h.total_len = htonl(static_cast<uint32_t>(data.size()));
+    h.count = htons(static_cast<uint16_t>(frags));
+    for (size_t i = 0; i < frags; ++i)
+    {
+        const size_t offset = i * chunk;
+        h.offset = htonl(static_cast<uint32_t>(offset));
+        h.index = htons(static_cast<uint16_t>(i));
+
+        // Header and payload go out as one datagram without copying the payload
+        struct iovec iov[2];
+        iov[0].iov_base = &h;
+        iov[0].iov_len = sizeof(h);
+        iov[1].iov_base = const_cast<uint8_t*>(data.data() + offset);
+        iov[1].iov_len = std::min(chunk, data.size() - offset);
+        struct msghdr msg{};
+        msg.msg_name = &m_addr;
+        msg.msg_namelen = sizeof(m_addr);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        if (sendmsg(m_fd, &msg, 0) < 0)
+        {
+            LOG_WARN("send fragment {} of {} failed: {}", i, frags, strerror(errno));
+            return -1;
+        }
+    }
+    return static_cast<int>(data.size());
+}
 } // namespace XH
\ No newline at end of file
@@ -1,6 +1,24 @@
 #include "basic/thread.h"
+#include <cstdlib>
 #include <string>
 
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+    #include <algorithm>
+    #include <fstream>
+    #include <map>
+    #include <tuple>
+    #include <utility>
+    #if defined(__linux__) || defined(__APPLE__)
+        #include <pthread.h>
+        #include <sched.h>
+        #include <sys/resource.h>
+        #include <unistd.h>
+    #endif
+    #if defined(__linux__)
+        #include <sys/syscall.h>
+    #endif
+#endif
+
 namespace XH {
 thread_local std::optional<std::size_t> this_thread::m_index = std::nullopt;
 thread_local std::optional<void*> this_thread::m_pool = std::nullopt;
@@ -17,7 +35,7 @@ std::optional<std::string> this_thread::get_os_thread_name() noexcept
 #elif defined(__linux__) || defined(__APPLE__)
     // Linux and macOS-specific code to get thread name
     #ifdef __APPLE__
-        constexpr std:size_t buffer_size = 16;
+        constexpr std::size_t buffer_size = 16;
     #else
         constexpr std::size_t buffer_size = 64;
     #endif
@@ -52,7 +70,52 @@ bool this_thread::set_os_thread_name(const std::string& name) noexcept
 }
 
 #ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
-std::optional<std:vector<bool>> this_thread::get_os_thread_affinity() noexcept
+#if defined(__linux__)
+namespace {
+// Cpu ids can be sparse (offline cpus), so size masks by the configured count, not the online one.
+std::size_t configured_cpus() noexcept
+{
+    const long count = sysconf(_SC_NPROCESSORS_CONF);
+    return std::min<std::size_t>(count > 0 ? static_cast<std::size_t>(count) : std::thread::hardware_concurrency(), CPU_SETSIZE);
+}
+
+// Parses cpu lists such as "0-3,8,10-11" (the format of /sys/devices/system/cpu/online).
+std::vector<std::size_t> parse_cpu_list(const std::string& list)
+{
+    std::vector<std::size_t> cpus;
+    std::size_t pos = 0;
+    while (pos < list.size())
+    {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        const std::string range = list.substr(pos, end - pos);
+        const std::size_t dash = range.find('-');
+        char* tail = nullptr;
+        const unsigned long first = std::strtoul(range.c_str(), &tail, 10);
+        if (tail != range.c_str())
+        {
+            const unsigned long last = (dash == std::string::npos) ? first : std::strtoul(range.c_str() + dash + 1, nullptr, 10);
+            for (unsigned long cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+std::optional<std::size_t> read_topology_value(const std::size_t cpu, const char* name)
+{
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    long value = -1;
+    if (!(file >> value) || value < 0)
+        return std::nullopt;
+    return static_cast<std::size_t>(value);
+}
+} // namespace
+#endif
+
+std::optional<std::vector<bool>> this_thread::get_os_thread_affinity() noexcept
 {
     #if defined(__WIN32__)
         // Windows-specific code to get thread affinity
@@ -70,7 +133,7 @@ std::optional<std:vector<bool>> this_thread::get_os_thread_affinity() noexcept
         if (sched_getaffinity(0, sizeof(mask), &mask) == -1)
             return std::nullopt;
 
-        std::vector<bool> affinity(std::thread::hardware_concurrency());
+        std::vector<bool> affinity(configured_cpus());
         for (std::size_t i = 0; i < affinity.size(); ++i)
         {
             affinity[i] = CPU_ISSET(i, &mask);
@@ -96,17 +159,33 @@ bool this_thread::set_os_thread_affinity(std::vector<bool> affinity) noexcept
     // Linux-specific code to set thread affinity
     cpu_set_t mask;
     CPU_ZERO(&mask);
-    for (std::size_t i = 0; i < affinity.size(); ++i)
+    for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), CPU_SETSIZE); ++i)
     {
         if (affinity[i])
             CPU_SET(i, &mask);
     }
+    // With pid 0 this only affects the calling thread.
     return sched_setaffinity(0, sizeof(mask), &mask) == 0;
 #else
     return false; // Not supported on this platform
 #endif
 }
 
+bool this_thread::pin_to_cpu(const std::size_t cpu) noexcept
+{
+    try
+    {
+        std::vector<bool> affinity(cpu + 1, false);
+        affinity[cpu] = true;
+        return set_os_thread_affinity(std::move(affinity));
+    }
+    catch (...)
+    {
+        // Building the mask can only fail on allocation, e.g. for an absurd cpu index.
+        return false;
+    }
+}
+
 std::optional<os_thread_priority> this_thread::get_os_thread_priority() noexcept
 {
 #if defined(_WIN32)
@@ -303,5 +382,97 @@ bool this_thread::set_os_thread_priority(const os_thread_priority priority) noex
 #endif
 }
 
+std::vector<cpu_info> read_cpu_topology() noexcept
+{
+    std::vector<cpu_info> topology;
+#if defined(__linux__)
+    try
+    {
+        std::ifstream online("/sys/devices/system/cpu/online");
+        std::string list;
+        std::vector<std::size_t> cpus;
+        if (std::getline(online, list))
+            cpus = parse_cpu_list(list);
+        if (cpus.empty())
+        {
+            for (std::size_t cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu)
+                cpus.push_back(cpu);
+        }
+        for (const std::size_t cpu : cpus)
+        {
+            topology.push_back({cpu, read_topology_value(cpu, "core_id").value_or(cpu), read_topology_value(cpu, "physical_package_id").value_or(0)});
+        }
+        std::sort(topology.begin(), topology.end(),
+            [](const cpu_info& lhs, const cpu_info& rhs)
+            {
+                return std::tie(lhs.package, lhs.core, lhs.id) < std::tie(rhs.package, rhs.core, rhs.id);
+            });
+    }
+    catch (...)
+    {
+        // Reading sysfs or allocating failed; callers treat an empty topology as "don't pin".
+        topology.clear();
+    }
 #endif
-}
\ No newline at end of file
+    return topology;
+}
+
+std::vector<std::size_t> placement_cpus(const thread_placement& placement, const std::vector<cpu_info>& topology, const std::size_t count)
+{
+    std::vector<std::size_t> order;
+    switch (placement.policy)
+    {
+    case placement_policy::compact:
+        // The topology is already sorted by (package, core, id).
+        for (const cpu_info& cpu : topology)
+            order.push_back(cpu.id);
+        break;
+    case placement_policy::scatter:
+    {
+        // Rank every cpu by (hyperthread index within its core, core index within its socket, socket),
+        // so consecutive workers land on different sockets, then different cores.
+        struct ranked
+        {
+            std::size_t sibling;
+            std::size_t core;
+            std::size_t package;
+            std::size_t id;
+        };
+        std::vector<ranked> ranks;
+        std::map<std::pair<std::size_t, std::size_t>, std::size_t> siblings;
+        std::map<std::size_t, std::size_t> cores_in_package;
+        std::map<std::pair<std::size_t, std::size_t>, std::size_t> core_rank;
+        for (const cpu_info& cpu : topology)
+        {
+            const auto key = std::make_pair(cpu.package, cpu.core);
+            if (core_rank.find(key) == core_rank.end())
+                core_rank[key] = cores_in_package[cpu.package]++;
+            ranks.push_back({siblings[key]++, core_rank[key], cpu.package, cpu.id});
+        }
+        std::sort(ranks.begin(), ranks.end(),
+            [](const ranked& lhs, const ranked& rhs)
+            {
+                return std::tie(lhs.sibling, lhs.core, lhs.package, lhs.id) < std::tie(rhs.sibling, rhs.core, rhs.package, rhs.id);
+            });
+        for (const ranked& cpu : ranks)
+            order.push_back(cpu.id);
+        break;
+    }
+    case placement_policy::explicit_list:
+        order = placement.cpus;
+        break;
+    case placement_policy::none:
+    default:
+        break;
+    }
+
+    std::vector<std::size_t> cpus;
+    if (order.empty())
+        return cpus;
+    cpus.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        cpus.push_back(order[i % order.size()]);
+    return cpus;
+}
+#endif
+}
@@ -1,5 +1,15 @@
 #include "basic/log.h"
-#include <future>
+#include "basic/log_sink.h"
+#include "basic/thread.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 Log &Log::GetInstance()
@@ -8,7 +18,7 @@ Log &Log::GetInstance()
     return instance;
 }
 
-bool Log::Init(std::string_view file, uint32_t queueSize, int levelMask)
+bool Log::Init(std::string_view file, uint32_t queueSize, int levelMask, size_t capacity, OverflowPolicy policy, LogMode mode)
 {
     std::filesystem::path p(file);
 
@@ -16,69 +26,699 @@ bool Log::Init(std::string_view file, uint32_t queueSize, int levelMask)
         return false;
     }
 
+    // 重复Init时先把旧文件的日志写完
+    Stop();
+
+    std::lock_guard lk(mut);
     // format of full path : [path + logname + Y-M-D], 这里是为了后续的统一处理
     m_fullPath = p;
     m_filename = p.filename();
-    m_levelMask = levelMask;
-    m_queueSize = queueSize;
+    m_fileLevel = levelMask;
+    UpdateLevelMask();
+    m_batchSize = std::max<uint32_t>(queueSize, 1);
+    m_ringBytes = capacity;
+    m_policy = policy == OverflowPolicy::Block ? OverflowPolicy::Block : OverflowPolicy::DropNewest;
+    m_mode = mode;
+
+    CreateLog(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    StartWriter();
+    return true;
+}
+
+void Log::SetTimePrecision(LogTimePrecision precision)
+{
+    std::lock_guard lk(mut);
+    m_clock.SetPrecision(precision);
+}
+
+void Log::SetRotation(LogRotation rotation)
+{
+    std::lock_guard lk(mut);
+    m_rotation = std::move(rotation);
+}
+
+void Log::SetOutput(LogOutput output, size_t window)
+{
+    std::lock_guard lk(mut);
+    bool reopen = m_fd >= 0;
+    if (reopen) {
+        WriteBuffer();
+        CloseLog();
+    }
+    m_output = output;
+    m_mmap.SetWindow(window);
+    if (reopen) {
+        CreateLog(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+}
+
+void Log::AddSink(std::shared_ptr<LogSink> sink, int level, size_t capacity)
+{
+    std::lock_guard lk(mut);
+    m_sinks.push_back(std::make_unique<LogSinkWorker>(std::move(sink), level, capacity));
+    if (m_batch == nullptr) {
+        m_batch = std::make_shared<LogBatch>();
+    }
+    UpdateLevelMask();
+}
+
+void Log::RemoveSink(const std::shared_ptr<LogSink>& sink)
+{
+    std::unique_ptr<LogSinkWorker> removed;
+    {
+        std::lock_guard lk(mut);
+        auto it = std::find_if(m_sinks.begin(), m_sinks.end(), [&sink](const auto& w) { return w->Sink() == sink; });
+        if (it == m_sinks.end()) {
+            return;
+        }
+        removed = std::move(*it);
+        m_sinks.erase(it);
+        UpdateLevelMask();
+    }
+    // 不持mut等sink线程写完，不耽误写文件
+    removed.reset();
+}
+
+uint64_t Log::SinkDropped(const std::shared_ptr<LogSink>& sink)
+{
+    std::lock_guard lk(mut);
+    for (const std::unique_ptr<LogSinkWorker>& w : m_sinks) {
+        if (w->Sink() == sink) {
+            return w->Dropped();
+        }
+    }
+    return 0;
+}
+
+void Log::UpdateLevelMask()
+{
+    m_sinkLevel = LEVEL_OFF;
+    for (const std::unique_ptr<LogSinkWorker>& w : m_sinks) {
+        m_sinkLevel = std::min(m_sinkLevel, w->Level());
+    }
+    s_levelMask = std::min(m_fileLevel, m_sinkLevel);
+}
+
+void Log::SetSyncPolicy(std::chrono::milliseconds interval, size_t bytes)
+{
+    m_syncIntervalMs = std::max<int64_t>(interval.count(), 1);
+    m_syncBytes = std::max<size_t>(bytes, 1);
+}
+
+uint32_t Log::RegisterFormat(int level, std::string_view fmt)
+{
+    return LogFormatTable::Instance().Register(level, fmt);
+}
+
+fmt::memory_buffer& Log::LocalBuffer()
+{
+    thread_local fmt::memory_buffer buf;
+    return buf;
+}
+
+LogRing& Log::LocalRing()
+{
+    struct Holder {
+        std::shared_ptr<LogRing> ring;
+        ~Holder()
+        {
+            if (ring) {
+                ring->Close();
+            }
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.ring) {
+        holder.ring = std::make_shared<LogRing>(m_ringBytes.load());
+        std::lock_guard lk(m_ringsMut);
+        m_rings.push_back(holder.ring);
+        m_ringsVersion.fetch_add(1, std::memory_order_release);
+    }
+    return *holder.ring;
+}
+
+void Log::Publish(std::string_view payload)
+{
+    LogRing& ring = LocalRing();
+    // 二进制记录截断后解不出来，超长的直接丢掉
+    if (payload.size() > ring.MaxMessage()) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint64_t ts = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    while (!ring.TryWrite(ts, payload)) {
+        // 没有后台线程时等不到空位
+        if (m_policy.load(std::memory_order_relaxed) == OverflowPolicy::DropNewest || !m_running.load(std::memory_order_relaxed)) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_dataReady.NotifyOne();
+        std::this_thread::yield();
+    }
+    m_dataReady.NotifyOne();
+}
+
+void Log::StartWriter()
+{
+    {
+        std::lock_guard lk(m_syncMut);
+        m_writing = true;
+    }
+    m_stopping = false;
+    m_running = true;
+    m_writer = std::thread([this]() { WriterLoop(); });
+}
+
+void Log::StopWriter()
+{
+    {
+        std::lock_guard lk(m_syncMut);
+        if (!m_writing) {
+            return;
+        }
+    }
+    m_stopping = true;
+    m_dataReady.NotifyAll();
+    m_writer.join();
+    m_running = false;
+    {
+        std::lock_guard lk(m_syncMut);
+        m_writing = false;
+    }
+    m_syncCv.notify_all();
+}
 
-    CreateLog(fmt::format("{:%Y-%m-%d:%H:%M}", std::chrono::system_clock::now()));
+void Log::WriterLoop()
+{
+    uint64_t flushed = 0;
+    while (true) {
+        bool stopping = m_stopping.load();
+        uint64_t ticket;
+        {
+            std::lock_guard lk(m_syncMut);
+            ticket = m_flushTicket;
+        }
+
+        std::unique_lock lk(mut);
+        if (stopping || ticket != flushed) {
+            // 读ticket之前写入的日志都还在各线程缓冲区里，全部写出后fsync
+            DrainRings();
+            Sync();
+            lk.unlock();
+            flushed = ticket;
+            {
+                std::lock_guard slk(m_syncMut);
+                m_flushedTicket = ticket;
+            }
+            m_syncCv.notify_all();
+            if (stopping) {
+                return;
+            }
+            continue;
+        }
+
+        if (WriteRings(m_batchSize) > 0) {
+            MaybeSync();
+            continue;
+        }
+
+        // 没有新日志，睡到有人写日志、Flush/Stop或者该按时间fsync
+        uint64_t key = m_dataReady.PrepareWait();
+        if (!RingsEmpty() || m_stopping.load()) {
+            m_dataReady.CancelWait();
+            continue;
+        }
+        {
+            std::lock_guard slk(m_syncMut);
+            if (m_flushTicket != flushed) {
+                m_dataReady.CancelWait();
+                continue;
+            }
+        }
+        int32_t ms = SyncWaitMs();
+        lk.unlock();
+        if (ms < 0) {
+            m_dataReady.Wait(key);
+        } else if (!m_dataReady.WaitUntil(key, std::chrono::steady_clock::now() + std::chrono::milliseconds(ms))) {
+            lk.lock();
+            MaybeSync();
+        }
+    }
+}
+
+void Log::RefreshRings()
+{
+    uint64_t version = m_ringsVersion.load(std::memory_order_acquire);
+    if (version == m_readVersion) {
+        return;
+    }
+    std::lock_guard lk(m_ringsMut);
+    // 线程已退出并且读空的缓冲区不再需要
+    auto retired = [](const std::shared_ptr<LogRing>& ring) {
+        LogRing::Entry entry;
+        return ring->Closed() && !ring->Front(entry);
+    };
+    m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), retired), m_rings.end());
+    m_readRings = m_rings;
+    m_readVersion = m_ringsVersion.load(std::memory_order_relaxed);
+}
+
+bool Log::RingsEmpty()
+{
+    RefreshRings();
+    LogRing::Entry entry;
+    for (const std::shared_ptr<LogRing>& ring : m_readRings) {
+        if (ring->Front(entry)) {
+            return false;
+        }
+    }
     return true;
 }
 
+size_t Log::WriteRings(size_t maxLines)
+{
+    // Init之前只缓存不落盘
+    if (m_filename.empty()) {
+        return 0;
+    }
+    RefreshRings();
+    size_t n = m_readRings.size();
+    m_fronts.resize(n);
+    m_hasFront.assign(n, false);
+    for (size_t i = 0; i < n; ++i) {
+        m_hasFront[i] = m_readRings[i]->Front(m_fronts[i]);
+    }
+
+    size_t lines = 0;
+    while (lines < maxLines) {
+        // 线程数不多，线性找时间戳最小的
+        size_t pick = n;
+        for (size_t i = 0; i < n; ++i) {
+            if (m_hasFront[i] && (pick == n || m_fronts[i].ts < m_fronts[pick].ts)) {
+                pick = i;
+            }
+        }
+        if (pick == n) {
+            break;
+        }
+        AppendRecord(m_fronts[pick].ts, m_fronts[pick].msg);
+        m_readRings[pick]->Pop();
+        m_hasFront[pick] = m_readRings[pick]->Front(m_fronts[pick]);
+        ++lines;
+    }
+    WriteBuffer();
+    for (size_t i = 0; i < n; ++i) {
+        if (!m_hasFront[i] && m_readRings[i]->Closed()) {
+            // 线程已退出并且读空了，下次刷新时回收它的缓冲区
+            m_ringsVersion.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+    return lines;
+}
+
+void Log::DrainRings()
+{
+    if (m_filename.empty()) {
+        return;
+    }
+    // 最多取各缓冲区能装下的条数，生产者一直写也不会卡在这里
+    RefreshRings();
+    size_t limit = 0;
+    for (const std::shared_ptr<LogRing>& ring : m_readRings) {
+        limit += ring->MaxRecords();
+    }
+    size_t drained = 0;
+    while (drained < limit) {
+        size_t n = WriteRings(m_batchSize);
+        if (n == 0) {
+            break;
+        }
+        drained += n;
+    }
+}
+
+void Log::AppendRecord(uint64_t ts, std::string_view payload)
+{
+    uint32_t id;
+    std::string_view args;
+    if (!LogCodec::SplitPayload(payload, id, args)) {
+        return;
+    }
+    if (id >= m_formats.size()) {
+        LogFormatTable::Instance().CopySince(m_formats.size(), m_formats);
+        if (id >= m_formats.size()) {
+            return;
+        }
+    }
+    const LogFormatInfo& info = m_formats[id];
+    bool toFile = info.level >= m_fileLevel;
+    bool toSinks = !m_sinks.empty() && info.level >= m_sinkLevel;
+
+    // 只比较整数天数，同一天内不用格式化日期
+    bool newDay = toFile && m_clock.Day(ts) != m_day;
+    if (toFile && (newDay || m_fd < 0 || NeedRotate(ts))) {
+        WriteBuffer();
+        if (m_fd < 0) {
+            CreateLog(ts);
+        } else {
+            Rotate(ts, newDay);
+        }
+    }
+
+    if (toSinks) {
+        // sink要的是文本，只格式化一次，文本文件直接拷一份
+        size_t begin = m_batch->text.size();
+        LogCodec::FormatLine(m_batch->text, info.level, m_clock.Format(ts), info.pattern, args);
+        m_batch->lines.emplace_back(static_cast<uint32_t>(m_batch->text.size()), static_cast<uint8_t>(info.level));
+        if (toFile && m_mode == LogMode::Text) {
+            m_buffer.append(m_batch->text, begin);
+            return;
+        }
+    }
+    if (!toFile) {
+        return;
+    }
+    if (m_mode == LogMode::Text) {
+        LogCodec::FormatLine(m_buffer, info.level, m_clock.Format(ts), info.pattern, args);
+        return;
+    }
+    // 每个文件里格式定义写在第一次用到它的日志之前
+    if (m_formatWritten.size() <= id) {
+        m_formatWritten.resize(m_formats.size(), false);
+    }
+    if (!m_formatWritten[id]) {
+        LogCodec::AppendFormatRecord(m_buffer, id, info);
+        m_formatWritten[id] = true;
+    }
+    LogCodec::AppendLogRecord(m_buffer, id, ts, args);
+}
+
+void Log::WriteBuffer()
+{
+    size_t off = 0;
+    if (m_output == LogOutput::Mmap) {
+        // 预分配失败（磁盘满）时和write出错一样丢掉这一批剩下的部分
+        off = m_mmap.Append(m_buffer);
+    }
+    while (m_output == LogOutput::Write && m_fd >= 0 && off < m_buffer.size()) {
+        ssize_t n = ::write(m_fd, m_buffer.data() + off, m_buffer.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 磁盘出错时丢掉这一批，不让后台线程卡死
+            break;
+        }
+        off += n;
+    }
+    m_unsynced += off;
+    m_fileBytes += off;
+    m_buffer.clear();
+    PublishBatch();
+}
+
+void Log::PublishBatch()
+{
+    if (m_batch == nullptr || m_batch->lines.empty()) {
+        return;
+    }
+    std::shared_ptr<const LogBatch> batch = std::move(m_batch);
+    for (const std::unique_ptr<LogSinkWorker>& w : m_sinks) {
+        w->Push(batch);
+    }
+    // 还在sink队列里的那份不能复用，换一块新的
+    m_batch = std::make_shared<LogBatch>();
+    m_batch->text.reserve(batch->text.capacity());
+    m_batch->lines.reserve(batch->lines.capacity());
+}
+
+void Log::Sync()
+{
+    if (m_mmap.Attached()) {
+        m_mmap.Sync();
+    } else if (m_fd >= 0 && m_unsynced > 0) {
+        fsync(m_fd);
+    }
+    m_unsynced = 0;
+    m_lastSync = std::chrono::steady_clock::now();
+}
+
+void Log::MaybeSync()
+{
+    if (m_unsynced == 0) {
+        return;
+    }
+    if (m_unsynced >= m_syncBytes.load() ||
+        std::chrono::steady_clock::now() - m_lastSync >= std::chrono::milliseconds(m_syncIntervalMs.load())) {
+        Sync();
+    }
+}
+
+int32_t Log::SyncWaitMs() const
+{
+    if (m_unsynced == 0) {
+        return -1;
+    }
+    auto due = m_lastSync + std::chrono::milliseconds(m_syncIntervalMs.load());
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now()).count();
+    return static_cast<int32_t>(std::clamp<int64_t>(left, 0, INT32_MAX));
+}
+
 void Log::Flush()
 {
-    // 为了避免有两个线程在做文件持久化
-    std::unique_lock lk(mut, std::defer_lock);
-    if (!lk.try_lock()) {
+    std::unique_lock slk(m_syncMut);
+    if (!m_writing) {
+        // 没有后台线程（Init之前或者Stop之后）时由调用者自己落盘
+        slk.unlock();
+        std::lock_guard lk(mut);
+        DrainRings();
+        Sync();
         return;
     }
+    uint64_t ticket = ++m_flushTicket;
+    slk.unlock();
+    m_dataReady.NotifyAll();
+    slk.lock();
+    m_syncCv.wait(slk, [this, ticket]() { return m_flushedTicket >= ticket || !m_writing; });
+}
+
+uint64_t Log::Dropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void Log::CreateLog(uint64_t ts)
+{
+    CloseLog();
+
+    m_day = m_clock.Day(ts);
+    m_logtime = m_clock.Date(ts);  // xxxx-xx-xx
+
+    m_fullPath = m_fullPath.parent_path().append(m_filename + "_" + m_logtime + (m_mode == LogMode::Binary ? ".bin" : ""));
+
+    m_formatWritten.clear();
+    if (m_output == LogOutput::Mmap) {
+        m_fd = ::open(m_fullPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd >= 0 && !m_mmap.Attach(m_fd, m_mode == LogMode::Text)) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_fileBytes = m_mmap.Size();
+    } else {
+        m_fd = ::open(m_fullPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        struct stat st;
+        m_fileBytes = m_fd >= 0 && fstat(m_fd, &st) == 0 ? st.st_size : 0;
+    }
+    m_fileOpenedTs = ts;
+    if (m_mode == LogMode::Binary && m_fd >= 0 && m_fileBytes == 0) {
+        m_buffer.insert(0, LogCodec::MAGIC);
+    }
+    m_lastSync = std::chrono::steady_clock::now();
+}
 
-    std::optional<std::string> log;
-    while ((log = m_logQueue.Pop())) {
-        if (std::string t = log.value().substr(OFF_SET, TAIL_LEN); m_logtime != t || m_fp == nullptr) {
-            CreateLog(t);
+void Log::CloseLog()
+{
+    if (m_fd >= 0) {
+        Sync();
+        if (!m_mmap.Detach()) {
+            std::cerr << "log: truncate " << m_fullPath << " failed: " << strerror(errno) << std::endl;
         }
-        // 偷懒没判断返回
-        // 且这里并没有做磁盘写入的操作
-        std::fwrite(log.value().data(), sizeof(log.value().front()), log.value().size(), m_fp);
-        fsync(fileno(m_fp));
+        ::close(m_fd);
+        m_fd = -1;
     }
 }
 
-void Log::AutoFlush()
+bool Log::NeedRotate(uint64_t ts) const
 {
-    if (m_queueSize < m_logQueue.Size()) {
-        (void)std::async(std::launch::async, [this]() { Flush(); });
+    if (m_rotation.maxBytes != 0 && m_fileBytes + m_buffer.size() >= m_rotation.maxBytes) {
+        return true;
     }
+    uint64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(m_rotation.interval).count();
+    return interval != 0 && ts >= m_fileOpenedTs + interval;
 }
 
-void Log::CreateLog(std::string time)
+void Log::Rotate(uint64_t ts, bool newDay)
 {
-    Stop();
+    std::filesystem::path file = m_fullPath;
+    CloseLog();
+    // 前一天的文件名里已经有日期，不用改名
+    if (!newDay) {
+        std::filesystem::path archive = NextArchivePath();
+        std::error_code ec;
+        std::filesystem::rename(file, archive, ec);
+        if (!ec) {
+            file = archive;
+        }
+    }
+    // 新文件建好后再排队，清理时才认得出哪个是正在写的文件
+    CreateLog(ts);
+    QueueArchive(file);
+}
 
-    m_logtime = time.substr(0, TAIL_LEN);  // xxxx-xx-xx
+std::filesystem::path Log::NextArchivePath() const
+{
+    // 压缩后文件名会多一个后缀，按前缀找已经用过的最大序号
+    std::string stem = m_filename + "_" + m_logtime + ".";
+    size_t last = 0;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(m_fullPath.parent_path(), ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, stem.size(), stem) != 0) {
+            continue;
+        }
+        size_t n = 0;
+        size_t i = stem.size();
+        for (; i < name.size() && name[i] >= '0' && name[i] <= '9'; ++i) {
+            n = n * 10 + (name[i] - '0');
+        }
+        if (i > stem.size()) {
+            last = std::max(last, n);
+        }
+    }
+    std::string ext = m_mode == LogMode::Binary ? ".bin" : "";
+    return m_fullPath.parent_path() / (stem + std::to_string(last + 1) + ext);
+}
 
-    m_fullPath = m_fullPath.parent_path().append(m_filename + "_" + m_logtime);
+void Log::QueueArchive(std::filesystem::path file)
+{
+    if (!m_rotation.compress && m_rotation.keep == 0) {
+        return;
+    }
+    if (!m_archiver.joinable()) {
+        m_archiver = std::thread([this]() { ArchiveLoop(); });
+    }
+    m_archiveJobs.Push(ArchiveJob{std::move(file), m_rotation.compress, m_rotation.keep, m_filename, m_fullPath});
+}
 
-    m_fp = fopen(m_fullPath.c_str(), "a");
+void Log::ArchiveLoop()
+{
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+    XH::this_thread::set_os_thread_priority(XH::os_thread_priority::idle);
+#endif
+    // 还在排队的文件没压缩过，修改时间也比压缩出来的文件早，等队列空了再清理，免得删掉没处理的文件
+    std::optional<ArchiveJob> prune;
+    while (true) {
+        std::optional<ArchiveJob> job = m_archiveJobs.Pop(-1);
+        if (job->file.empty()) {
+            break;
+        }
+        if (job->compress) {
+            job->compress(job->file);
+        }
+        if (job->keep != 0) {
+            prune = std::move(job);
+        }
+        if (prune && m_archiveJobs.Size() == 0) {
+            PruneArchives(*prune);
+            prune.reset();
+        }
+    }
+    if (prune) {
+        PruneArchives(*prune);
+    }
+}
+
+void Log::PruneArchives(const ArchiveJob& job)
+{
+    // 同一个日志名下除了正在写的文件都算切换下来的，按修改时间只留最新的keep个
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> archives;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(job.active.parent_path(), ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file(ec) && IsArchiveOf(name, job.name) && entry.path() != job.active) {
+            archives.emplace_back(entry.last_write_time(ec), entry.path());
+        }
+    }
+    if (archives.size() <= job.keep) {
+        return;
+    }
+    std::sort(archives.begin(), archives.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = job.keep; i < archives.size(); ++i) {
+        std::filesystem::remove(archives[i].second, ec);
+    }
+}
+
+bool Log::IsArchiveOf(std::string_view file, std::string_view name)
+{
+    if (file.size() < name.size() + 11 || file.compare(0, name.size(), name) != 0 || file[name.size()] != '_') {
+        return false;
+    }
+    std::string_view date = file.substr(name.size() + 1, 10);
+    for (size_t i = 0; i < date.size(); ++i) {
+        bool dash = i == 4 || i == 7;
+        if (dash ? date[i] != '-' : (date[i] < '0' || date[i] > '9')) {
+            return false;
+        }
+    }
+    // 日期后面只能是若干段.xxx：序号、.bin、压缩后缀
+    std::string_view rest = file.substr(name.size() + 11);
+    while (!rest.empty()) {
+        if (rest[0] != '.') {
+            return false;
+        }
+        size_t len = 1;
+        while (len < rest.size() && std::isalnum(static_cast<unsigned char>(rest[len]))) {
+            ++len;
+        }
+        if (len == 1) {
+            return false;
+        }
+        rest.remove_prefix(len);
+    }
+    return true;
+}
+
+void Log::StopArchiver()
+{
+    if (!m_archiver.joinable()) {
+        return;
+    }
+    m_archiveJobs.Push(ArchiveJob{});
+    m_archiver.join();
 }
 
 void Log::Stop()
 {
-    Flush();
-    if (m_fp != nullptr) {
-        std::fclose(m_fp);
-        m_fp = nullptr;
+    StopWriter();
+    {
+        std::lock_guard lk(mut);
+        DrainRings();
+        CloseLog();
     }
+    // 等切换下来的文件压缩、清理完
+    StopArchiver();
 }
 
 Log::Log()
 {
-    m_fp = nullptr;
+    m_fd = -1;
+    m_batchSize = FLUSH_BATCH;
 }
 
 Log::~Log()
 {
-    Flush();
+    Stop();
+    m_sinks.clear();
 }
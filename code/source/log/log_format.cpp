@@ -0,0 +1,348 @@
+#include "basic/log_format.h"
+#include "basic/log.h"
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <time.h>
+#include "fmt/args.h"
+
+LogClock::LogClock(LogTimePrecision precision) : m_precision(precision)
+{
+}
+
+void LogClock::SetPrecision(LogTimePrecision precision)
+{
+    m_precision = precision;
+    // 让下次Format重新生成文本
+    m_begin = 1;
+    m_end = 0;
+}
+
+void LogClock::Refresh(uint64_t ts)
+{
+    constexpr uint64_t NS = 1000000000;
+    time_t sec = static_cast<time_t>(ts / NS);
+    struct tm tm;
+    localtime_r(&sec, &tm);
+
+    int64_t local = static_cast<int64_t>(sec) + tm.tm_gmtoff;
+    m_day = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+
+    m_text.clear();
+    fmt::format_to(std::back_inserter(m_text), "{:04}-{:02}-{:02}:{:02}:{:02}",
+                   tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min);
+    if (m_precision == LogTimePrecision::Minute) {
+        m_begin = (static_cast<uint64_t>(sec) - tm.tm_sec) * NS;
+        m_end = m_begin + 60 * NS;
+        return;
+    }
+    fmt::format_to(std::back_inserter(m_text), ":{:02}", tm.tm_sec);
+    if (m_precision == LogTimePrecision::Microsecond) {
+        m_text += ".000000";
+    }
+    m_begin = static_cast<uint64_t>(sec) * NS;
+    m_end = m_begin + NS;
+}
+
+std::string_view LogClock::Format(uint64_t ts)
+{
+    if (ts < m_begin || ts >= m_end) {
+        Refresh(ts);
+    }
+    if (m_precision == LogTimePrecision::Microsecond) {
+        uint64_t us = (ts - m_begin) / 1000;
+        char* p = m_text.data() + m_text.size();
+        for (int i = 0; i < 6; ++i) {
+            *--p = static_cast<char>('0' + us % 10);
+            us /= 10;
+        }
+    }
+    return m_text;
+}
+
+int64_t LogClock::Day(uint64_t ts)
+{
+    if (ts < m_begin || ts >= m_end) {
+        Refresh(ts);
+    }
+    return m_day;
+}
+
+std::string_view LogClock::Date(uint64_t ts)
+{
+    return Format(ts).substr(0, 10);
+}
+
+LogFormatTable& LogFormatTable::Instance()
+{
+    static LogFormatTable instance;
+    return instance;
+}
+
+LogFormatTable::LogFormatTable()
+{
+    for (int level = 0; level < static_cast<int>(LogCodec::BUILTIN_FORMATS); ++level) {
+        m_formats.push_back({level, "{}"});
+    }
+}
+
+uint32_t LogFormatTable::Register(int level, std::string_view pattern)
+{
+    std::lock_guard lk(m_mut);
+    m_formats.push_back({level, std::string(pattern)});
+    return static_cast<uint32_t>(m_formats.size() - 1);
+}
+
+void LogFormatTable::CopySince(size_t from, std::vector<LogFormatInfo>& out)
+{
+    std::lock_guard lk(m_mut);
+    for (size_t i = from; i < m_formats.size(); ++i) {
+        out.push_back(m_formats[i]);
+    }
+}
+
+namespace {
+template <typename T>
+bool Take(std::string_view& in, T& v)
+{
+    if (in.size() < sizeof(T)) {
+        return false;
+    }
+    memcpy(&v, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+bool TakeString(std::string_view& in, std::string_view& s)
+{
+    uint32_t len;
+    if (!Take(in, len) || in.size() < len) {
+        return false;
+    }
+    s = in.substr(0, len);
+    in.remove_prefix(len);
+    return true;
+}
+
+// 流里还剩多少字节，不能seek的流返回UINT64_MAX
+uint64_t Remaining(std::istream& in)
+{
+    std::istream::pos_type pos = in.tellg();
+    if (pos == std::istream::pos_type(-1)) {
+        return UINT64_MAX;
+    }
+    in.seekg(0, std::ios::end);
+    std::istream::pos_type end = in.tellg();
+    in.clear();
+    in.seekg(pos);
+    if (end == std::istream::pos_type(-1) || end < pos) {
+        return UINT64_MAX;
+    }
+    return static_cast<uint64_t>(end - pos);
+}
+
+// 分块读len字节，不能seek的流遇到损坏的长度字段也只多分配一块
+bool ReadBytes(std::istream& in, std::string& s, uint32_t len)
+{
+    constexpr size_t CHUNK = 64 << 10;
+    s.clear();
+    while (s.size() < len) {
+        size_t old = s.size();
+        s.resize(old + std::min<size_t>(CHUNK, len - old));
+        if (!in.read(s.data() + old, s.size() - old)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 参数还原成fmt的动态参数，字符串只存指向args的view
+bool LoadArgs(std::string_view args, fmt::dynamic_format_arg_store<fmt::format_context>& store)
+{
+    while (!args.empty()) {
+        uint8_t type;
+        Take(args, type);
+        bool ok = false;
+        switch (static_cast<LogArgType>(type)) {
+            case LogArgType::Int: {
+                int64_t v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(v);
+                }
+                break;
+            }
+            case LogArgType::Uint: {
+                uint64_t v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(v);
+                }
+                break;
+            }
+            case LogArgType::Double: {
+                double v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(v);
+                }
+                break;
+            }
+            case LogArgType::Float: {
+                float v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(v);
+                }
+                break;
+            }
+            case LogArgType::Char: {
+                char v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(v);
+                }
+                break;
+            }
+            case LogArgType::Bool: {
+                uint8_t v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(v != 0);
+                }
+                break;
+            }
+            case LogArgType::String: {
+                std::string_view v;
+                if ((ok = TakeString(args, v))) {
+                    store.push_back(fmt::string_view(v.data(), v.size()));
+                }
+                break;
+            }
+            case LogArgType::Pointer: {
+                uint64_t v;
+                if ((ok = Take(args, v))) {
+                    store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(v)));
+                }
+                break;
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+bool LogCodec::SplitPayload(std::string_view payload, uint32_t& id, std::string_view& args)
+{
+    if (!Take(payload, id)) {
+        return false;
+    }
+    args = payload;
+    return true;
+}
+
+void LogCodec::FormatLine(std::string& out, int level, std::string_view time, std::string_view pattern, std::string_view args)
+{
+    // [level] | time | message
+    out += '[';
+    out += level >= 0 && level < 4 ? LOG_LEVEL[level] : '?';
+    out += "] | ";
+    out += time;
+    out += " |";
+
+    thread_local fmt::dynamic_format_arg_store<fmt::format_context> store;
+    store.clear();
+    if (!LoadArgs(args, store)) {
+        out += pattern;
+        out += " <bad arguments>\n";
+        return;
+    }
+    try {
+        fmt::vformat_to(std::back_inserter(out), fmt::string_view(pattern.data(), pattern.size()), store);
+    } catch (const fmt::format_error& e) {
+        out += pattern;
+        out += " <format error: ";
+        out += e.what();
+        out += '>';
+    }
+    out += '\n';
+}
+
+void LogCodec::AppendFormatRecord(std::string& out, uint32_t id, const LogFormatInfo& info)
+{
+    out += FORMAT_RECORD;
+    Put<uint32_t>(out, id);
+    Put<uint8_t>(out, static_cast<uint8_t>(info.level));
+    Put<uint32_t>(out, static_cast<uint32_t>(info.pattern.size()));
+    out += info.pattern;
+}
+
+void LogCodec::AppendLogRecord(std::string& out, uint32_t id, uint64_t ts, std::string_view args)
+{
+    out += LOG_RECORD;
+    Put<uint32_t>(out, id);
+    Put<uint64_t>(out, ts);
+    Put<uint32_t>(out, static_cast<uint32_t>(args.size()));
+    out += args;
+}
+
+bool LogCodec::Decode(std::istream& in, std::ostream& out, LogTimePrecision precision)
+{
+    std::string magic(MAGIC.size(), '\0');
+    if (!in.read(magic.data(), magic.size()) || magic != MAGIC) {
+        return false;
+    }
+
+    // 长度字段不能超过剩下的字节数，损坏的文件不会让这里分配大块内存
+    uint64_t left = Remaining(in);
+    auto read = [&in, &left](auto& v) {
+        left -= sizeof(v);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(v)));
+    };
+    auto readBytes = [&in, &left](std::string& s, uint32_t len) {
+        if (len > left) {
+            return false;
+        }
+        left -= len;
+        return ReadBytes(in, s, len);
+    };
+    std::vector<LogFormatInfo> formats;
+    std::string args;
+    std::string line;
+    LogClock clock(precision);
+    char tag;
+    while (in.get(tag)) {
+        --left;
+        if (tag == '\0') {
+            // mmap输出异常退出后留下的预分配空间，之后可能还接着有记录
+            continue;
+        }
+        uint32_t id;
+        uint32_t len;
+        if (tag == FORMAT_RECORD) {
+            uint8_t level;
+            if (!read(id) || !read(level) || !read(len) || id > MAX_FORMAT_ID) {
+                return false;
+            }
+            // 每次打开文件都会重新定义用到的格式，后出现的覆盖先出现的
+            if (formats.size() <= id) {
+                formats.resize(id + 1, {0, "{}"});
+            }
+            formats[id].level = level;
+            if (!readBytes(formats[id].pattern, len)) {
+                return false;
+            }
+        } else if (tag == LOG_RECORD) {
+            uint64_t ts;
+            if (!read(id) || !read(ts) || !read(len) || id >= formats.size()) {
+                return false;
+            }
+            if (!readBytes(args, len)) {
+                return false;
+            }
+            line.clear();
+            FormatLine(line, formats[id].level, clock.Format(ts), formats[id].pattern, args);
+            out << line;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
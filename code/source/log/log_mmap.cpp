@@ -0,0 +1,128 @@
+#include "basic/log_mmap.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+LogMmapFile::LogMmapFile(size_t window) : m_page(static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+{
+    SetWindow(window);
+}
+
+LogMmapFile::~LogMmapFile()
+{
+    Detach();
+}
+
+void LogMmapFile::SetWindow(size_t window)
+{
+    m_window = std::max((window + m_page - 1) / m_page * m_page, m_page);
+}
+
+bool LogMmapFile::Attach(int fd, bool trimZeros)
+{
+    Detach();
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        return false;
+    }
+    m_fd = fd;
+    m_allocated = st.st_size;
+    m_size = m_allocated;
+    // 从后往前找最后一个非0字节，正常关闭的文件第一次读就能找到
+    char buf[4096];
+    while (trimZeros && m_size > 0) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(sizeof(buf), m_size));
+        if (pread(m_fd, buf, n, m_size - n) != static_cast<ssize_t>(n)) {
+            break;
+        }
+        size_t i = n;
+        while (i > 0 && buf[i - 1] == '\0') {
+            --i;
+        }
+        m_size -= n - i;
+        if (i > 0) {
+            break;
+        }
+    }
+    m_synced = m_size;
+    return true;
+}
+
+bool LogMmapFile::Detach()
+{
+    if (m_fd < 0) {
+        return true;
+    }
+    Sync();
+    Unmap();
+    bool ok = m_allocated == m_size || ftruncate(m_fd, m_size) == 0;
+    m_fd = -1;
+    m_size = 0;
+    m_synced = 0;
+    m_allocated = 0;
+    return ok;
+}
+
+bool LogMmapFile::Map(uint64_t offset)
+{
+    Unmap();
+    uint64_t end = offset + m_window;
+    if (m_allocated < end) {
+        // fallocate提前分配好磁盘块，写映射区时不会因为磁盘满收到SIGBUS；不支持的文件系统退回ftruncate
+        if (fallocate(m_fd, 0, m_allocated, end - m_allocated) != 0 &&
+            (errno != EOPNOTSUPP || ftruncate(m_fd, end) != 0)) {
+            return false;
+        }
+        m_allocated = end;
+    }
+    void* p = mmap(nullptr, m_window, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, offset);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    m_map = static_cast<char*>(p);
+    m_mapOffset = offset;
+    return true;
+}
+
+void LogMmapFile::Unmap()
+{
+    if (m_map != nullptr) {
+        munmap(m_map, m_window);
+        m_map = nullptr;
+    }
+}
+
+size_t LogMmapFile::Append(std::string_view data)
+{
+    size_t total = data.size();
+    while (!data.empty()) {
+        if (m_map == nullptr || m_size >= m_mapOffset + m_window) {
+            if (m_fd < 0 || !Map(m_size / m_page * m_page)) {
+                break;
+            }
+        }
+        size_t n = static_cast<size_t>(std::min<uint64_t>(data.size(), m_mapOffset + m_window - m_size));
+        memcpy(m_map + (m_size - m_mapOffset), data.data(), n);
+        m_size += n;
+        data.remove_prefix(n);
+    }
+    return total - data.size();
+}
+
+void LogMmapFile::Sync()
+{
+    if (m_fd < 0 || m_synced == m_size) {
+        return;
+    }
+    if (m_map != nullptr && m_synced >= m_mapOffset) {
+        uint64_t from = m_synced / m_page * m_page;
+        msync(m_map + (from - m_mapOffset), m_size - from, MS_SYNC);
+    } else {
+        fdatasync(m_fd);
+    }
+    m_synced = m_size;
+}
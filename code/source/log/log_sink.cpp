@@ -0,0 +1,90 @@
+#include "basic/log_sink.h"
+#include <errno.h>
+#include <unistd.h>
+
+void StderrSink::Write(std::string_view lines)
+{
+    while (!lines.empty()) {
+        ssize_t n = ::write(STDERR_FILENO, lines.data(), lines.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        lines.remove_prefix(n);
+    }
+}
+
+UdpSink::UdpSink(std::string ip, int port, size_t maxDatagram)
+    : m_ip(std::move(ip)), m_port(port), m_maxDatagram(std::max<size_t>(maxDatagram, 1))
+{
+}
+
+void UdpSink::Write(std::string_view lines)
+{
+    // 尽量多装整行，一行都装不下时按最大长度切开
+    while (!lines.empty()) {
+        size_t n = lines.size();
+        if (n > m_maxDatagram) {
+            size_t end = lines.rfind('\n', m_maxDatagram - 1);
+            n = end == std::string_view::npos ? m_maxDatagram : end + 1;
+        }
+        Send(lines.substr(0, n));
+        lines.remove_prefix(n);
+    }
+}
+
+void UdpSink::Send(std::string_view datagram)
+{
+    m_sender.send(m_ip, m_port, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(datagram.data()), datagram.size()));
+}
+
+LogSinkWorker::LogSinkWorker(std::shared_ptr<LogSink> sink, int level, size_t capacity)
+    : m_sink(std::move(sink)), m_level(level), m_queue(std::max<size_t>(capacity, 1), OverflowPolicy::DropOldest)
+{
+    m_thread = std::thread([this]() { Run(); });
+}
+
+LogSinkWorker::~LogSinkWorker()
+{
+    // 放开容量，退出标记不会挤掉还没写的日志
+    m_queue.SetCapacity(0);
+    m_queue.Push(nullptr);
+    m_thread.join();
+}
+
+void LogSinkWorker::Push(std::shared_ptr<const LogBatch> batch)
+{
+    m_queue.Push(std::move(batch));
+}
+
+void LogSinkWorker::Run()
+{
+    while (true) {
+        std::optional<std::shared_ptr<const LogBatch>> batch = m_queue.Pop(-1);
+        if (*batch == nullptr) {
+            break;
+        }
+        // 等级够的连续几行合成一次Write
+        const LogBatch& b = **batch;
+        uint32_t begin = 0;
+        uint32_t runBegin = 0;
+        for (const auto& [end, level] : b.lines) {
+            if (level < m_level) {
+                if (runBegin < begin) {
+                    m_sink->Write(std::string_view(b.text).substr(runBegin, begin - runBegin));
+                }
+                runBegin = end;
+            }
+            begin = end;
+        }
+        if (runBegin < begin) {
+            m_sink->Write(std::string_view(b.text).substr(runBegin, begin - runBegin));
+        }
+        if (m_queue.SizeHint() == 0) {
+            m_sink->Flush();
+        }
+    }
+    m_sink->Flush();
+}
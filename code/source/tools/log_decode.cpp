@@ -0,0 +1,30 @@
+#include "basic/log_format.h"
+#include <fstream>
+#include <iostream>
+
+// 把LogMode::Binary写出的日志文件转成文本，和LogMode::Text的输出一致
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " <file.bin> [out.txt]" << std::endl;
+        return 2;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::ofstream file;
+    if (argc == 3) {
+        file.open(argv[2], std::ios::binary);
+        if (!file) {
+            std::cerr << "cannot open " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    if (!LogCodec::Decode(in, argc == 3 ? file : std::cout)) {
+        std::cerr << argv[1] << ": not a binary log or truncated" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "basic/coro_task.h"
+#include "basic/thread_pool.h"
+#include "test_util.h"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+
+XH::task<int> add(const int lhs, const int rhs)
+{
+    co_return lhs + rhs;
+}
+
+XH::task<int> add_three(const int a, const int b, const int c)
+{
+    const int partial = co_await add(a, b);
+    co_return co_await add(partial, c);
+}
+
+XH::task<void> noop()
+{
+    co_return;
+}
+
+XH::task<void> fail()
+{
+    throw std::runtime_error("fail");
+    co_return;
+}
+
+template <typename Pool>
+XH::task<int> square_on(Pool& pool, const int value)
+{
+    co_await pool.schedule();
+    EXPECT_EQ(XH::this_thread::get_pool(), &pool);
+    co_return value * value;
+}
+
+template <typename Pool>
+XH::task<int> sleep_on(Pool& pool, const int value, const std::chrono::milliseconds delay)
+{
+    co_await pool.schedule();
+    std::this_thread::sleep_for(delay);
+    co_return value;
+}
+
+TEST(CoroTaskTest, SyncWaitChainsAndExceptions)
+{
+    EXPECT_EQ(XH::sync_wait(add_three(1, 2, 3)), 6);
+    EXPECT_THROW(XH::sync_wait(fail()), std::runtime_error);
+}
+
+TEST(CoroTaskTest, ScheduleResumesOnWorker)
+{
+    XH::base_thread_pool_t pool(2);
+    EXPECT_EQ(XH::sync_wait(square_on(pool, 7)), 49);
+
+    XH::thread_pool<XH::topt_t::work_stealing> stealing_pool(2);
+    EXPECT_EQ(XH::sync_wait(square_on(stealing_pool, 5)), 25);
+}
+
+TEST(CoroTaskTest, WhenAllAndWhenAny)
+{
+    XH::base_thread_pool_t pool(4);
+
+    std::vector<XH::task<int>> squares;
+    for (int i = 0; i < 16; ++i)
+        squares.push_back(square_on(pool, i));
+    const std::vector<int> results = XH::sync_wait(XH::when_all(std::move(squares)));
+    ASSERT_EQ(results.size(), 16);
+    for (int i = 0; i < 16; ++i)
+        EXPECT_EQ(results[i], i * i);
+
+    const auto [sum, unit, square] = XH::sync_wait(XH::when_all(add_three(1, 1, 1), noop(), square_on(pool, 3)));
+    EXPECT_EQ(sum, 3);
+    EXPECT_EQ(square, 9);
+
+    std::vector<XH::task<void>> failing;
+    failing.push_back(fail());
+    EXPECT_THROW(XH::sync_wait(XH::when_all(std::move(failing))), std::runtime_error);
+
+    std::vector<XH::task<int>> racers;
+    racers.push_back(sleep_on(pool, 0, std::chrono::milliseconds(200)));
+    racers.push_back(sleep_on(pool, 1, std::chrono::milliseconds(0)));
+    const XH::when_any_result<int> first = XH::sync_wait(XH::when_any(std::move(racers)));
+    EXPECT_EQ(first.index, 1);
+    EXPECT_EQ(first.value, 1);
+    pool.wait();
+}
+
+TEST(CoroTaskTest, FramesComeFromThePool)
+{
+    // Warm the freelists, after that a whole chain of frames must not touch the heap.
+    EXPECT_EQ(XH::sync_wait(add_three(1, 2, 3)), 6);
+    const std::size_t before = allocation_count();
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(XH::sync_wait(add_three(i, 1, 1)), i + 2);
+    EXPECT_EQ(allocation_count() - before, 0);
+}
+}
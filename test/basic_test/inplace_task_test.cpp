@@ -0,0 +1,45 @@
+#include "basic/inplace_task.h"
+#include <array>
+#include <gtest/gtest.h>
+#include <memory>
+
+namespace XH::TEST {
+
+TEST(InplaceTaskTest, MoveOnlyCaptureAndStorage)
+{
+    using small_task = XH::inplace_task<32>;
+    int result = 0;
+
+    auto owned = std::make_unique<int>(7);
+    small_task task([&result, owned = std::move(owned)] { result = *owned; });
+    EXPECT_TRUE(task.is_inline());
+
+    small_task moved(std::move(task));
+    EXPECT_FALSE(static_cast<bool>(task));
+    moved();
+    EXPECT_EQ(result, 7);
+
+    // Captures beyond the inline budget still work, through one heap allocation.
+    std::array<int, 16> big{};
+    big[15] = 3;
+    small_task heap([&result, big] { result = big[15]; });
+    EXPECT_FALSE(heap.is_inline());
+    moved = std::move(heap);
+    moved();
+    EXPECT_EQ(result, 3);
+}
+
+TEST(InplaceTaskTest, DestroysCapture)
+{
+    auto counter = std::make_shared<int>(0);
+    {
+        XH::inplace_task<32> task([counter] {});
+        EXPECT_EQ(counter.use_count(), 2);
+        task.reset();
+        EXPECT_EQ(counter.use_count(), 1);
+        task = [counter] {};
+        EXPECT_EQ(counter.use_count(), 2);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+}
+}
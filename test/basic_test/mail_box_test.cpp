@@ -5,6 +5,11 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <functional>
 #include "basic/mail_box.h"
 
 namespace XH::TEST {
@@ -17,8 +22,8 @@ TEST(MailBoxTest, loopback) {
     ASSERT_EQ(box.bind(ip, port), 0) << "Failed to bind mail box";
 
     // Register a handler to process incoming messages
-    std::unique_ptr<XH::msg_buf> msg_buf = nullptr;
-    box.regist_handler([&msg_buf](XH::mail_box* o, std::unique_ptr<XH::msg_buf>&& msg) {
+    XH::msg_ptr msg_buf = nullptr;
+    box.regist_handler([&msg_buf](XH::mail_box* o, XH::msg_ptr&& msg) {
         msg_buf = std::move(msg);
         o->remove_event();
     });
@@ -36,4 +41,285 @@ TEST(MailBoxTest, loopback) {
     // Clean up
     event_base_free(base);
 }
-}
\ No newline at end of file
+
+TEST(MailBoxTest, batch_handler_gets_all_queued_datagrams) {
+    XH::mail_box box(4);
+    XH::mail_sender sender;
+
+    int port = 12346;
+    std::string ip = "127.0.0.1";
+    ASSERT_EQ(box.bind(ip, port), 0) << "Failed to bind mail box";
+
+    // 10 datagrams queued before the loop runs arrive in batches of at most 4
+    std::vector<size_t> batch_sizes;
+    std::vector<std::string> received;
+    box.regist_batch_handler([&](XH::mail_box* o, std::span<const XH::msg_view> msgs) {
+        batch_sizes.push_back(msgs.size());
+        for (const XH::msg_view& msg : msgs)
+        {
+            received.emplace_back(reinterpret_cast<const char*>(msg.buf.data()), msg.buf.size());
+            EXPECT_EQ(msg.src_addr.sin_addr.s_addr, inet_addr(ip.c_str()));
+        }
+        if (received.size() == 10)
+        {
+            o->remove_event();
+        }
+    });
+
+    struct event_base* base = event_base_new();
+    ASSERT_NE(base, nullptr) << "Failed to create event base";
+    box.add_event(base);
+    for (int i = 0; i < 10; ++i)
+    {
+        std::string msg = "msg " + std::to_string(i);
+        sender.send(ip, port, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(msg.data()), msg.size()));
+    }
+    event_base_dispatch(base);
+
+    ASSERT_EQ(received.size(), 10u);
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(received[i], "msg " + std::to_string(i));
+    }
+    EXPECT_EQ(batch_sizes, (std::vector<size_t>{4, 4, 2}));
+    event_base_free(base);
+}
+
+TEST(MailBoxTest, pooled_buffers_recycle_across_threads) {
+    int port = 12347;
+    std::string ip = "127.0.0.1";
+    XH::mail_sender sender;
+    auto send_n = [&](int n) {
+        for (int i = 0; i < n; ++i)
+        {
+            std::string msg = "msg " + std::to_string(i);
+            sender.send(ip, port, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(msg.data()), msg.size()));
+        }
+    };
+
+    XH::msg_ptr survivor;
+    {
+        XH::mail_box box(8);
+        ASSERT_EQ(box.bind(ip, port), 0) << "Failed to bind mail box";
+        struct event_base* base = event_base_new();
+        ASSERT_NE(base, nullptr) << "Failed to create event base";
+
+        // Hold 100 messages, more than one slab, then hand them to another thread to release
+        std::vector<XH::msg_ptr> held;
+        box.regist_handler([&held](XH::mail_box* o, XH::msg_ptr&& msg) {
+            held.push_back(std::move(msg));
+            if (held.size() == 100)
+            {
+                o->remove_event();
+            }
+        });
+        box.add_event(base);
+        send_n(100);
+        event_base_dispatch(base);
+        ASSERT_EQ(held.size(), 100u);
+        EXPECT_EQ(std::string(reinterpret_cast<const char*>(held[99]->buf.data()), held[99]->buf.size()), "msg 99");
+        EXPECT_GE(box.pool_stats().in_use, 100u);
+        std::thread([held = std::move(held)]() mutable { held.clear(); }).join();
+        const XH::msg_pool::stats warm = box.pool_stats();
+
+        // Steady state: messages released right away reuse the same slots
+        int received = 0;
+        box.regist_handler([&received, &survivor](XH::mail_box* o, XH::msg_ptr&& msg) {
+            if (++received == 200)
+            {
+                survivor = std::move(msg);
+                o->remove_event();
+            }
+        });
+        box.add_event(base);
+        send_n(200);
+        event_base_dispatch(base);
+        ASSERT_EQ(received, 200);
+        const XH::msg_pool::stats steady = box.pool_stats();
+        EXPECT_EQ(steady.allocations, warm.allocations);
+        EXPECT_EQ(steady.slots, warm.slots);
+        // Only the mail_box's 8 receive slots and the survivor are still out
+        EXPECT_LE(steady.in_use, 9u);
+        event_base_free(base);
+    }
+    // The pool outlives the mail_box until the last message is released
+    ASSERT_NE(survivor, nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(survivor->buf.data()), survivor->buf.size()), "msg 199");
+    survivor.reset();
+}
+
+namespace {
+// Runs the loop until the handler has seen n messages
+std::vector<std::string> receive_n(XH::mail_box& box, size_t n, const std::function<void()>& send)
+{
+    std::vector<std::string> received;
+    box.regist_handler([&received, n](XH::mail_box* o, XH::msg_ptr&& msg) {
+        received.emplace_back(reinterpret_cast<const char*>(msg->buf.data()), msg->buf.size());
+        if (received.size() == n)
+        {
+            o->remove_event();
+        }
+    });
+    struct event_base* base = event_base_new();
+    box.add_event(base);
+    send();
+    event_base_dispatch(base);
+    event_base_free(base);
+    return received;
+}
+
+std::span<const uint8_t> as_bytes(const std::string& s)
+{
+    return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+std::string pattern(size_t size)
+{
+    std::string s(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+    {
+        s[i] = static_cast<char>('a' + i % 26);
+    }
+    return s;
+}
+} // namespace
+
+TEST(MailBoxTest, oversized_datagrams_are_dropped_not_truncated) {
+    XH::mail_sender sender;
+    std::string ip = "127.0.0.1";
+    const std::string big = pattern(60000);
+
+    XH::mail_box jumbo(4, XH::MAX_DATAGRAM_SIZE);
+    ASSERT_EQ(jumbo.bind(ip, 12348), 0);
+    auto received = receive_n(jumbo, 1, [&] { sender.send(ip, 12348, as_bytes(big)); });
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], big);
+
+    XH::mail_box box;
+    ASSERT_EQ(box.bind(ip, 12349), 0);
+    EXPECT_EQ(box.max_msg_size(), 1024u);
+    received = receive_n(box, 1, [&] {
+        sender.send(ip, 12349, as_bytes(pattern(1025)));
+        sender.send(ip, 12349, as_bytes(pattern(1024)));
+    });
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], pattern(1024));
+    EXPECT_EQ(box.truncated(), 1u);
+}
+
+TEST(MailBoxTest, fragmented_messages_are_reassembled) {
+    XH::mail_sender sender;
+    std::string ip = "127.0.0.1";
+    int port = 12350;
+    XH::mail_box box;
+    ASSERT_EQ(box.bind(ip, port), 0);
+    box.enable_reassembly({});
+
+    const std::string snapshot = pattern(50000);
+    auto received = receive_n(box, 3, [&] {
+        EXPECT_EQ(sender.send_fragmented(ip, port, as_bytes(snapshot)), 50000);
+        EXPECT_EQ(sender.send_fragmented(ip, port, as_bytes("small")), 5);
+        // Without a frag_header it passes through untouched
+        sender.send(ip, port, as_bytes("plain"));
+    });
+    ASSERT_EQ(received.size(), 3u);
+    EXPECT_EQ(received[0], snapshot);
+    EXPECT_EQ(received[1], "small");
+    EXPECT_EQ(received[2], "plain");
+    EXPECT_EQ(box.reassembly_dropped(), 0u);
+
+    // Single-fragment messages are not copied out of their slot
+    bool in_slot = false;
+    box.regist_handler([&in_slot](XH::mail_box* o, XH::msg_ptr&& msg) {
+        in_slot = msg->reassembled.empty() && msg->buf.data() == msg->slot + sizeof(XH::frag_header);
+        o->remove_event();
+    });
+    struct event_base* base = event_base_new();
+    box.add_event(base);
+    sender.send_fragmented(ip, port, as_bytes("small"));
+    event_base_dispatch(base);
+    event_base_free(base);
+    EXPECT_TRUE(in_slot);
+}
+
+TEST(MailBoxTest, incomplete_messages_time_out) {
+    XH::mail_sender sender;
+    std::string ip = "127.0.0.1";
+    int port = 12351;
+    XH::mail_box box;
+    ASSERT_EQ(box.bind(ip, port), 0);
+    XH::mail_box::reassembly_options options;
+    options.timeout = std::chrono::milliseconds(10);
+    box.enable_reassembly(options);
+
+    // First of two fragments, the second never comes
+    XH::frag_header h{};
+    h.magic = htonl(XH::frag_header::FRAG_MAGIC);
+    h.msg_id = htonl(7);
+    h.total_len = htonl(8);
+    h.count = htons(2);
+    std::string fragment(reinterpret_cast<const char*>(&h), sizeof(h));
+    fragment += "half";
+
+    auto received = receive_n(box, 1, [&] {
+        sender.send(ip, port, as_bytes(fragment));
+        sender.send(ip, port, as_bytes("before"));
+    });
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(box.reassembly_dropped(), 0u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    received = receive_n(box, 1, [&] { sender.send(ip, port, as_bytes("after")); });
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], "after");
+    EXPECT_EQ(box.reassembly_dropped(), 1u);
+}
+
+namespace {
+std::string make_fragment(uint32_t msg_id, uint32_t total, uint32_t offset, uint16_t index, uint16_t count,
+                          const std::string& payload)
+{
+    XH::frag_header h{};
+    h.magic = htonl(XH::frag_header::FRAG_MAGIC);
+    h.msg_id = htonl(msg_id);
+    h.total_len = htonl(total);
+    h.offset = htonl(offset);
+    h.index = htons(index);
+    h.count = htons(count);
+    return std::string(reinterpret_cast<const char*>(&h), sizeof(h)) + payload;
+}
+} // namespace
+
+TEST(MailBoxTest, overlapping_fragments_are_rejected) {
+    XH::mail_sender sender;
+    std::string ip = "127.0.0.1";
+    int port = 12352;
+    XH::mail_box box;
+    ASSERT_EQ(box.bind(ip, port), 0);
+    box.enable_reassembly({});
+
+    auto received = receive_n(box, 1, [&] {
+        // Distinct indexes, but the second fragment doesn't start where the first one ends
+        sender.send(ip, port, as_bytes(make_fragment(1, 8, 0, 0, 2, "ab")));
+        sender.send(ip, port, as_bytes(make_fragment(1, 8, 4, 1, 2, "efgh")));
+        // Same offset under two different indexes
+        sender.send(ip, port, as_bytes(make_fragment(2, 8, 0, 0, 2, "abcd")));
+        sender.send(ip, port, as_bytes(make_fragment(2, 8, 0, 1, 2, "abcd")));
+        // Overlapping ranges that still end at total
+        sender.send(ip, port, as_bytes(make_fragment(3, 8, 0, 0, 2, "abcd")));
+        sender.send(ip, port, as_bytes(make_fragment(3, 8, 2, 1, 2, "cdefgh")));
+        sender.send(ip, port, as_bytes("after"));
+    });
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], "after");
+    EXPECT_EQ(box.reassembly_dropped(), 3u);
+
+    // Correctly laid out fragments still go through
+    received = receive_n(box, 1, [&] {
+        sender.send(ip, port, as_bytes(make_fragment(4, 7, 4, 1, 2, "efg")));
+        sender.send(ip, port, as_bytes(make_fragment(4, 7, 0, 0, 2, "abcd")));
+    });
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], "abcdefg");
+}
+}
@@ -0,0 +1,88 @@
+#include "mpmc_queue.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+
+TEST(MpmcQueueTest, BoundedFifo)
+{
+    MpmcQueue<std::string> queue(3);
+    EXPECT_EQ(queue.Capacity(), 4);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(queue.TryPush(std::to_string(i)));
+    EXPECT_FALSE(queue.TryPush("full"));
+    EXPECT_EQ(queue.Size(), 4);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(queue.Pop(), std::to_string(i));
+    EXPECT_FALSE(queue.Pop().has_value());
+
+    // Items still queued on destruction are destroyed with the queue.
+    auto tracked = std::make_shared<int>(1);
+    {
+        MpmcQueue<std::shared_ptr<int>> owner(2);
+        owner.Push(tracked);
+        EXPECT_EQ(tracked.use_count(), 2);
+    }
+    EXPECT_EQ(tracked.use_count(), 1);
+}
+
+TEST(MpmcQueueTest, TimedAndBlockingPop)
+{
+    MpmcQueue<int> queue(4);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(queue.Pop(20).has_value());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    std::thread producer([&queue]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue.Push(7);
+    });
+    EXPECT_EQ(queue.Pop(-1), 7);
+    producer.join();
+}
+
+TEST(MpmcQueueTest, ConcurrentProducersAndConsumers)
+{
+    constexpr int producers = 4;
+    constexpr int consumers = 4;
+    constexpr int per_producer = 20000;
+    // Small capacity so producers regularly block on a full queue.
+    MpmcQueue<int> queue(16);
+    std::atomic<long> sum{0};
+    std::atomic<int> consumed{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue]
+        {
+            for (int i = 1; i <= per_producer; ++i)
+                queue.Push(i);
+        });
+    }
+    for (int c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&]
+        {
+            while (consumed.load() < producers * per_producer)
+            {
+                if (std::optional<int> value = queue.Pop(5))
+                {
+                    sum += *value;
+                    ++consumed;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    EXPECT_EQ(consumed.load(), producers * per_producer);
+    EXPECT_EQ(sum.load(), long{producers} * per_producer * (per_producer + 1) / 2);
+}
+}
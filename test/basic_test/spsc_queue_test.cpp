@@ -0,0 +1,80 @@
+#include "spsc_queue.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace XH::TEST {
+
+TEST(SpscQueueTest, BoundedFifo)
+{
+    SpscQueue<std::string, 4> queue;
+    EXPECT_EQ(queue.GetCapacity(), 4);
+    EXPECT_TRUE(queue.Empty());
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(queue.TryPush(std::to_string(i)));
+    std::string rejected = "full";
+    EXPECT_FALSE(queue.TryPush(std::move(rejected)));
+    EXPECT_EQ(rejected, "full");
+    EXPECT_EQ(queue.Size(), 4);
+
+    ASSERT_NE(queue.Front(), nullptr);
+    EXPECT_EQ(*queue.Front(), "0");
+    queue.PopFront();
+    for (int i = 1; i < 4; ++i)
+        EXPECT_EQ(queue.TryPop(), std::to_string(i));
+    EXPECT_FALSE(queue.TryPop().has_value());
+    EXPECT_EQ(queue.Front(), nullptr);
+
+    // Wrap around the ring a few times.
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_TRUE(queue.TryEmplace(3, 'x'));
+        EXPECT_EQ(queue.TryPop(), "xxx");
+    }
+
+    // Items still queued on destruction are destroyed with the queue.
+    auto tracked = std::make_shared<int>(1);
+    {
+        SpscQueue<std::shared_ptr<int>, 2> owner;
+        EXPECT_TRUE(owner.TryPush(tracked));
+        EXPECT_EQ(tracked.use_count(), 2);
+    }
+    EXPECT_EQ(tracked.use_count(), 1);
+}
+
+TEST(SpscQueueTest, ProducerConsumerKeepOrder)
+{
+    constexpr int items = 200000;
+    // Small ring so both sides regularly see it full or empty and refresh their cached index.
+    SpscQueue<int, 8> queue;
+    std::thread producer([&queue]
+    {
+        for (int i = 0; i < items;)
+        {
+            if (queue.TryPush(i))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+    // Keep draining after a mismatch so the producer can finish and be joined before asserting.
+    int expected = 0;
+    int mismatches = 0;
+    while (expected < items)
+    {
+        if (std::optional<int> value = queue.TryPop())
+        {
+            mismatches += *value != expected;
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_TRUE(queue.Empty());
+}
+}
@@ -1,6 +1,7 @@
 #include "basic/thread_pool.h"
 #include "test_util.h"
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <future>
 #include <numeric>
 #include <thread>
@@ -44,4 +45,259 @@ TEST(ThreadPoolTester, ThreadPoolTest)
     EXPECT_EQ(futures.size(), test_thread_count);
     pool.reset();
 }
-}
\ No newline at end of file
+
+TEST(ThreadPoolTester, WorkStealingFanOut)
+{
+    constexpr std::size_t roots = 8;
+    constexpr std::size_t leaves = 1000;
+    std::atomic<std::size_t> done{0};
+    std::atomic<bool> all_on_pool{true};
+
+    XH::thread_pool<XH::topt_t::work_stealing> pool(4);
+    for (std::size_t r = 0; r < roots; ++r)
+    {
+        pool.submit_task([&]
+        {
+            // Children are pushed onto the submitting worker's own deque and stolen by the others.
+            for (std::size_t l = 0; l < leaves; ++l)
+            {
+                pool.submit_task([&]
+                {
+                    if (!XH::this_thread::get_index().has_value())
+                        all_on_pool = false;
+                    ++done;
+                });
+            }
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(done.load(), roots * leaves);
+    EXPECT_TRUE(all_on_pool.load());
+
+    // The pool must be reusable after an idle period.
+    pool.submit_task([&] { ++done; });
+    pool.wait();
+    EXPECT_EQ(done.load(), roots * leaves + 1);
+}
+
+
+TEST(ThreadPoolTester, PriorityHighClassLatency)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr std::size_t low_tasks = 2000;
+    constexpr std::size_t high_tasks = 100;
+
+    XH::thread_pool<XH::topt_t::priority> pool(2);
+    // Keep the pool saturated with bulk work for far longer than the measurement window.
+    for (std::size_t i = 0; i < low_tasks; ++i)
+    {
+        pool.submit_task([] { std::this_thread::sleep_for(std::chrono::microseconds(200)); }, XH::task_priority::low);
+    }
+
+    std::mutex mtx;
+    std::vector<clock::duration> delays;
+    for (std::size_t i = 0; i < high_tasks; ++i)
+    {
+        const auto submitted = clock::now();
+        pool.submit_task([&, submitted]
+        {
+            const auto delay = clock::now() - submitted;
+            std::lock_guard<std::mutex> lock(mtx);
+            delays.push_back(delay);
+        }, XH::task_priority::critical);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+
+    EXPECT_TRUE_FOR_X_MS(1000, [&] { std::lock_guard<std::mutex> lock(mtx); return delays.size() == high_tasks; }());
+    std::lock_guard<std::mutex> lock(mtx);
+    std::sort(delays.begin(), delays.end());
+    const auto p99 = delays[delays.size() * 99 / 100];
+    // A FIFO pool would make these wait behind ~200ms of queued bulk work.
+    EXPECT_LT(p99, std::chrono::milliseconds(20));
+}
+
+TEST(ThreadPoolTester, PriorityAgingPreventsStarvation)
+{
+    constexpr std::size_t high_tasks = 200;
+    std::atomic<std::size_t> order{0};
+    std::atomic<std::size_t> low_position{high_tasks + 1};
+
+    XH::thread_pool<XH::topt_t::priority> pool(1);
+    pool.set_priority_aging(std::chrono::milliseconds(1));
+    pool.submit_task([&] { low_position = order++; }, XH::task_priority::low);
+    // Critical work arrives faster than it is served, so without aging the low task runs last.
+    for (std::size_t i = 0; i < high_tasks; ++i)
+    {
+        pool.submit_task([&]
+        {
+            ++order;
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }, XH::task_priority::critical);
+        if (i % 2 == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    pool.wait();
+    EXPECT_LT(low_position.load(), high_tasks / 2);
+}
+
+
+TEST(ThreadPoolTester, SubmitReturnsFuture)
+{
+    XH::base_thread_pool_t pool(2);
+    std::future<int> value = pool.submit([] { return 42; });
+    std::future<void> done = pool.submit([] {});
+    std::future<int> error = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+
+    EXPECT_EQ(value.get(), 42);
+    done.get();
+    EXPECT_THROW(error.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTester, DetachLoopAndSubmitBlocks)
+{
+    constexpr std::size_t count = 10007;
+    std::vector<uint32_t> data(count);
+    XH::base_thread_pool_t pool(4);
+
+    pool.detach_loop<std::size_t>(0, count, [&data](std::size_t i) { data[i] = static_cast<uint32_t>(i); });
+    pool.wait();
+    for (std::size_t i = 0; i < count; ++i)
+        ASSERT_EQ(data[i], i);
+
+    // Uneven split: every index must be covered exactly once, in block order.
+    XH::multi_future<uint64_t> sums = pool.submit_blocks<std::size_t>(0, count,
+        [&data](std::size_t start, std::size_t end)
+        {
+            uint64_t sum = 0;
+            for (std::size_t i = start; i < end; ++i)
+                sum += data[i];
+            return sum;
+        }, 7);
+    EXPECT_EQ(sums.size(), 7);
+    const std::vector<uint64_t> partial = sums.get();
+    EXPECT_EQ(std::accumulate(partial.begin(), partial.end(), uint64_t{0}), uint64_t{count} * (count - 1) / 2);
+
+    XH::multi_future<void> empty = pool.submit_blocks(5, 5, [](int, int) {});
+    EXPECT_TRUE(empty.empty());
+}
+
+
+template <XH::topt_t opts>
+void check_submit_bulk()
+{
+    constexpr std::size_t batch = 257;
+    std::atomic<std::size_t> done{0};
+    XH::thread_pool<opts> pool(3);
+
+    std::vector<XH::task_t> tasks;
+    for (std::size_t i = 0; i < batch; ++i)
+        tasks.emplace_back([&done] { ++done; });
+    pool.submit_bulk(tasks);
+    pool.wait();
+    EXPECT_EQ(done.load(), batch);
+
+    // Any range of callables works, including batches submitted from a worker.
+    std::vector<std::function<void()>> callables(batch, [&done] { ++done; });
+    pool.submit_task([&] { pool.submit_bulk(callables.begin(), callables.end()); });
+    EXPECT_TRUE_FOR_X_MS(1000, done.load() == 2 * batch);
+    pool.wait();
+}
+
+TEST(ThreadPoolTester, SubmitBulk)
+{
+    check_submit_bulk<XH::topt_t::none>();
+    check_submit_bulk<XH::topt_t::priority>();
+    check_submit_bulk<XH::topt_t::work_stealing>();
+}
+template <XH::topt_t opts>
+void check_idle_strategy(const XH::idle_strategy strategy)
+{
+    std::atomic<std::size_t> done{0};
+    XH::thread_pool<opts> pool(2);
+    pool.set_idle_strategy(strategy, 1024);
+    for (int round = 0; round < 20; ++round)
+    {
+        pool.submit_task([&done] { ++done; });
+        // Let the workers run out of work so every round goes through the idle path.
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    pool.wait();
+    EXPECT_EQ(done.load(), 20);
+}
+
+TEST(ThreadPoolTester, IdleStrategies)
+{
+    for (const XH::idle_strategy strategy : {XH::idle_strategy::block, XH::idle_strategy::spin_then_block, XH::idle_strategy::busy_poll})
+    {
+        check_idle_strategy<XH::topt_t::none>(strategy);
+        check_idle_strategy<XH::topt_t::work_stealing>(strategy);
+    }
+}
+
+TEST(ThreadPoolTester, ScheduleAfterAndEvery)
+{
+    XH::base_thread_pool_t pool(2);
+    std::atomic<int> once{0};
+    std::atomic<int> repeated{0};
+    std::atomic<int> never{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<int64_t> fired_after_ms{0};
+    pool.schedule_after(std::chrono::milliseconds(20), [&]
+    {
+        fired_after_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        ++once;
+    });
+    XH::timer_handle<XH::task_t> every = pool.schedule_every(std::chrono::milliseconds(2), [&repeated] { ++repeated; });
+    XH::timer_handle<XH::task_t> cancelled = pool.schedule_after(std::chrono::milliseconds(5), [&never] { ++never; });
+    EXPECT_TRUE(cancelled.cancel());
+    EXPECT_FALSE(cancelled.cancel());
+
+    EXPECT_TRUE_FOR_X_MS(1000, once.load() == 1 && repeated.load() >= 5);
+    EXPECT_GE(fired_after_ms.load(), 20);
+
+    EXPECT_TRUE(every.cancel());
+    pool.wait();
+    const int runs = repeated.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(repeated.load(), runs);
+    EXPECT_EQ(never.load(), 0);
+
+    // Pending timers don't hold the pool up on destruction.
+    pool.schedule_after(std::chrono::hours(1), [&never] { ++never; });
+}
+
+template <XH::topt_t opts>
+void check_stats()
+{
+    constexpr std::size_t tasks = 200;
+    XH::thread_pool<opts | XH::topt_t::stats> pool(2);
+    for (std::size_t i = 0; i < tasks; ++i)
+        pool.submit_task([] { std::this_thread::sleep_for(std::chrono::microseconds(50)); });
+    pool.wait();
+
+    const XH::pool_stats stats = pool.snapshot();
+    ASSERT_EQ(stats.workers.size(), 2);
+    EXPECT_EQ(stats.queued_tasks, 0);
+    EXPECT_EQ(stats.tasks_executed(), tasks);
+    uint64_t histogram_total = 0;
+    uint64_t busy_ns = 0;
+    for (const XH::worker_stats& worker : stats.workers)
+    {
+        histogram_total += std::accumulate(worker.queue_wait_histogram.begin(), worker.queue_wait_histogram.end(), uint64_t{0});
+        busy_ns += worker.busy_ns;
+        EXPECT_GE(worker.waits, 1);
+    }
+    EXPECT_EQ(histogram_total, tasks);
+    EXPECT_GE(busy_ns, tasks * 50'000);
+    EXPECT_GT(stats.queue_wait_percentile(0.99), 0);
+    EXPECT_LE(stats.queue_wait_percentile(0.5), stats.queue_wait_percentile(0.99));
+}
+
+TEST(ThreadPoolTester, StatsSnapshot)
+{
+    check_stats<XH::topt_t::none>();
+    check_stats<XH::topt_t::priority>();
+    check_stats<XH::topt_t::work_stealing>();
+}
+}
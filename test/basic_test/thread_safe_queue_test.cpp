@@ -0,0 +1,105 @@
+#include "thread_safe_queue.h"
+#include <gtest/gtest.h>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+
+TEST(ThreadSafeQueueTest, MoveOnlyAndEmplace)
+{
+    ThreadSafeQueue<std::unique_ptr<int>> queue;
+    queue.Push(std::make_unique<int>(1));
+    queue.Emplace(new int(2));
+    EXPECT_EQ(queue.Size(), 2);
+    EXPECT_EQ(*queue.Pop().value(), 1);
+    EXPECT_EQ(*queue.Pop().value(), 2);
+    EXPECT_FALSE(queue.Pop().has_value());
+}
+
+TEST(ThreadSafeQueueTest, PushBulkAndPopBulk)
+{
+    ThreadSafeQueue<std::string> queue;
+    std::vector<std::string> items{"a", "b", "c", "d", "e"};
+    queue.PushBulk(items);
+    EXPECT_EQ(queue.Size(), 5);
+
+    std::vector<std::string> out;
+    EXPECT_EQ(queue.PopBulk(std::back_inserter(out), 3), 3);
+    EXPECT_EQ(out, (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_EQ(queue.PopBulk(std::back_inserter(out), 10), 2);
+    EXPECT_EQ(out.size(), 5);
+    EXPECT_EQ(out.back(), "e");
+
+    // Timed and blocking waits behave like Pop.
+    EXPECT_EQ(queue.PopBulk(std::back_inserter(out), 10, 10), 0);
+    std::thread producer([&queue]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue.Push("late");
+    });
+    EXPECT_EQ(queue.PopBulk(std::back_inserter(out), 10, -1), 1);
+    EXPECT_EQ(out.back(), "late");
+    producer.join();
+}
+
+TEST(ThreadSafeQueueTest, OverflowPolicies)
+{
+    ThreadSafeQueue<int> fail(2, OverflowPolicy::Fail);
+    EXPECT_TRUE(fail.Push(1));
+    EXPECT_TRUE(fail.Push(2));
+    EXPECT_FALSE(fail.Push(3));
+    EXPECT_EQ(fail.Dropped(), 0);
+
+    ThreadSafeQueue<int> newest(2, OverflowPolicy::DropNewest);
+    std::vector<int> items{1, 2, 3, 4};
+    EXPECT_EQ(newest.PushBulk(items), 2);
+    EXPECT_EQ(newest.Dropped(), 2);
+    EXPECT_EQ(newest.Pop(), 1);
+
+    ThreadSafeQueue<int> oldest(2, OverflowPolicy::DropOldest);
+    for (int i = 1; i <= 4; ++i)
+        EXPECT_TRUE(oldest.Push(i));
+    EXPECT_EQ(oldest.Dropped(), 2);
+    EXPECT_EQ(oldest.SizeHint(), 2);
+    EXPECT_EQ(oldest.Pop(), 3);
+    EXPECT_EQ(oldest.Pop(), 4);
+
+    // TryPush fails fast whatever the policy, and leaves a move-only element with the caller.
+    ThreadSafeQueue<std::unique_ptr<int>> blocking(1, OverflowPolicy::Block);
+    EXPECT_TRUE(blocking.TryPush(std::make_unique<int>(1)));
+    auto kept = std::make_unique<int>(2);
+    EXPECT_FALSE(blocking.TryPush(std::move(kept)));
+    ASSERT_NE(kept, nullptr);
+
+    // Block waits for a consumer to make room.
+    std::thread consumer([&blocking]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        EXPECT_EQ(*blocking.Pop().value(), 1);
+    });
+    EXPECT_TRUE(blocking.Push(std::move(kept)));
+    consumer.join();
+    EXPECT_EQ(*blocking.Pop().value(), 2);
+    EXPECT_EQ(blocking.Dropped(), 0);
+}
+
+TEST(ThreadSafeQueueTest, DropOldestAfterShrinkingFullQueue)
+{
+    ThreadSafeQueue<int> queue(8, OverflowPolicy::DropOldest);
+    for (int i = 1; i <= 8; ++i)
+        EXPECT_TRUE(queue.Push(i));
+    queue.SetCapacity(3, OverflowPolicy::DropOldest);
+    EXPECT_EQ(queue.Size(), 8);
+
+    // One push brings the queue back under the new capacity.
+    EXPECT_TRUE(queue.Push(9));
+    EXPECT_EQ(queue.Size(), 3);
+    EXPECT_EQ(queue.Dropped(), 6);
+    EXPECT_EQ(queue.Pop(), 7);
+    EXPECT_EQ(queue.Pop(), 8);
+    EXPECT_EQ(queue.Pop(), 9);
+}
+}
@@ -0,0 +1,66 @@
+#include "basic/thread.h"
+#include "basic/thread_pool.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+// 2 sockets x 2 cores x 2 hyperthreads, numbered the way Linux usually does: siblings are n and n + 4.
+std::vector<cpu_info> two_socket_topology()
+{
+    return {
+        {0, 0, 0}, {4, 0, 0}, {1, 1, 0}, {5, 1, 0},
+        {2, 0, 1}, {6, 0, 1}, {3, 1, 1}, {7, 1, 1},
+    };
+}
+
+TEST(ThreadTest, PlacementPolicies)
+{
+    const std::vector<cpu_info> topology = two_socket_topology();
+
+    const std::vector<std::size_t> compact = placement_cpus({placement_policy::compact}, topology, 4);
+    EXPECT_EQ(compact, (std::vector<std::size_t>{0, 4, 1, 5}));
+
+    // One worker per socket first, then the second core of each socket, hyperthreads last.
+    const std::vector<std::size_t> scatter = placement_cpus({placement_policy::scatter}, topology, 8);
+    EXPECT_EQ(scatter, (std::vector<std::size_t>{0, 2, 1, 3, 4, 6, 5, 7}));
+
+    const std::vector<std::size_t> list = placement_cpus({placement_policy::explicit_list, {3, 5}}, topology, 3);
+    EXPECT_EQ(list, (std::vector<std::size_t>{3, 5, 3}));
+
+    EXPECT_TRUE(placement_cpus({placement_policy::none}, topology, 4).empty());
+}
+
+TEST(ThreadTest, AffinityAndTopology)
+{
+    const std::vector<cpu_info> topology = read_cpu_topology();
+    ASSERT_FALSE(topology.empty());
+
+    // Pin pool workers with the real topology and check each ended up on exactly one cpu.
+    std::vector<std::size_t> pinned(2, 0);
+    {
+        XH::base_thread_pool_t pool(2,
+            [&pinned](std::size_t idx)
+            {
+                const auto affinity = this_thread::get_os_thread_affinity();
+                pinned[idx] = affinity ? static_cast<std::size_t>(std::count(affinity->begin(), affinity->end(), true)) : 0;
+            },
+            thread_placement{placement_policy::scatter});
+        pool.wait();
+    }
+    EXPECT_EQ(pinned, (std::vector<std::size_t>{1, 1}));
+}
+
+TEST(ThreadTest, OsThreadPriority)
+{
+    std::thread([]
+    {
+        // Lowering our own priority never needs privileges.
+        ASSERT_TRUE(this_thread::set_os_thread_priority(os_thread_priority::below_normal));
+        EXPECT_EQ(this_thread::get_os_thread_priority(), os_thread_priority::below_normal);
+    }).join();
+}
+#endif
+}
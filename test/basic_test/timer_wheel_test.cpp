@@ -0,0 +1,137 @@
+#include "basic/timer_wheel.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+namespace XH::TEST {
+
+using test_wheel = XH::timer_wheel<int>;
+using test_node = XH::timer_node<int>;
+
+// Advances tick by tick and returns the tick at which @node came due, 0 if it never did.
+uint64_t fire_tick(test_wheel& wheel, const std::shared_ptr<test_node>& node, const uint64_t limit)
+{
+    std::vector<std::shared_ptr<test_node>> expired;
+    for (uint64_t tick = wheel.now() + 1; tick <= limit; ++tick)
+    {
+        wheel.advance(tick, expired);
+        for (const auto& fired : expired)
+        {
+            if (fired == node)
+                return tick;
+        }
+        expired.clear();
+    }
+    return 0;
+}
+
+TEST(TimerWheelTest, FiresOnTheExactTickAcrossLevels)
+{
+    for (const uint64_t delay : {uint64_t{1}, uint64_t{255}, uint64_t{256}, uint64_t{300}, uint64_t{20000}, uint64_t{1} << 20})
+    {
+        test_wheel wheel;
+        // Start off a level boundary so cascading from a partially elapsed slot is covered.
+        std::vector<std::shared_ptr<test_node>> expired;
+        auto keep_alive = std::make_shared<test_node>();
+        wheel.add(keep_alive, 0, 1000, 0);
+        wheel.advance(77, expired);
+
+        auto node = std::make_shared<test_node>();
+        wheel.add(node, wheel.now(), delay, 0);
+        EXPECT_EQ(fire_tick(wheel, node, 77 + delay), 77 + delay) << "delay " << delay;
+    }
+}
+
+TEST(TimerWheelTest, CancelAndPeriodic)
+{
+    test_wheel wheel;
+    std::vector<std::shared_ptr<test_node>> expired;
+
+    auto once = std::make_shared<test_node>();
+    wheel.add(once, 0, 10, 0);
+    EXPECT_TRUE(wheel.cancel(*once));
+    EXPECT_FALSE(wheel.cancel(*once));
+    EXPECT_EQ(wheel.size(), 0);
+
+    auto periodic = std::make_shared<test_node>();
+    wheel.add(periodic, 0, 5, 5);
+    wheel.advance(22, expired);
+    // Due at 5, 10, 15 and 20, and still armed for 25.
+    EXPECT_EQ(expired.size(), 4);
+    EXPECT_EQ(wheel.size(), 1);
+    EXPECT_TRUE(wheel.cancel(*periodic));
+    expired.clear();
+    wheel.advance(100, expired);
+    EXPECT_TRUE(expired.empty());
+
+    // An idle wheel jumps straight to the caller's tick.
+    auto late = std::make_shared<test_node>();
+    wheel.add(late, 1'000'000, 3, 0);
+    EXPECT_EQ(wheel.now(), 1'000'000);
+    EXPECT_EQ(fire_tick(wheel, late, 1'000'010), 1'000'003);
+}
+
+TEST(TimerWheelTest, NextExpiryStopsAtOccupiedSlotOrWrap)
+{
+    test_wheel wheel;
+    std::vector<std::shared_ptr<test_node>> expired;
+    auto far = std::make_shared<test_node>();
+    wheel.add(far, 0, 1000, 0);
+    wheel.advance(10, expired);
+    // Only a coarser timer pending: the next stop is the level-0 wrap that cascades it.
+    EXPECT_EQ(wheel.next_expiry(), 256);
+
+    auto near = std::make_shared<test_node>();
+    wheel.add(near, 10, 40, 0);
+    EXPECT_EQ(wheel.next_expiry(), 50);
+    EXPECT_TRUE(wheel.cancel(*near));
+    EXPECT_EQ(wheel.next_expiry(), 256);
+
+    // Jumping from stop to stop fires the timer on its exact tick.
+    uint64_t stops = 0;
+    while (expired.empty())
+    {
+        wheel.advance(wheel.next_expiry(), expired);
+        ++stops;
+    }
+    EXPECT_EQ(wheel.now(), 1000);
+    EXPECT_LE(stops, 5);
+}
+
+TEST(TimerWheelTest, CancelWinsOverAnUndispatchedRun)
+{
+    auto wheel = std::make_shared<test_wheel>();
+    std::vector<std::shared_ptr<test_node>> expired;
+
+    // Came due and left the wheel, but its task hasn't run yet: cancel still stops it.
+    auto pending = std::make_shared<test_node>();
+    wheel->add(pending, 0, 3, 0);
+    XH::timer_handle<int> pending_handle(wheel, pending);
+    wheel->advance(3, expired);
+    ASSERT_EQ(expired.size(), 1);
+    EXPECT_TRUE(pending_handle.cancel());
+    EXPECT_TRUE(pending_handle.cancelled());
+    EXPECT_FALSE(pending->claim_run());
+
+    // Once the run has claimed the timer, cancel reports it as already fired.
+    auto ran = std::make_shared<test_node>();
+    wheel->add(ran, 3, 3, 0);
+    XH::timer_handle<int> ran_handle(wheel, ran);
+    expired.clear();
+    wheel->advance(6, expired);
+    ASSERT_EQ(expired.size(), 1);
+    EXPECT_TRUE(ran->claim_run());
+    EXPECT_FALSE(ran_handle.cancel());
+    EXPECT_FALSE(ran_handle.cancelled());
+
+    // A periodic timer keeps running until cancelled.
+    auto periodic = std::make_shared<test_node>();
+    wheel->add(periodic, 6, 2, 2);
+    XH::timer_handle<int> periodic_handle(wheel, periodic);
+    EXPECT_TRUE(periodic->claim_run());
+    EXPECT_TRUE(periodic->claim_run());
+    EXPECT_TRUE(periodic_handle.cancel());
+    EXPECT_FALSE(periodic->claim_run());
+    EXPECT_EQ(wheel->size(), 0);
+}
+}
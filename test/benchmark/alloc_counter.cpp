@@ -0,0 +1,96 @@
+// Global operator new/delete replacements that count heap allocations, so benchmarks can
+// assert a code path is malloc-free. They forward to malloc/free and are cheap enough to
+// stay linked into the whole test binary.
+#include "test_util.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<std::size_t> g_allocations{0};
+
+void* counted_alloc(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* counted_aligned_alloc(std::size_t size, std::align_val_t align)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t alignment = static_cast<std::size_t>(align);
+    // aligned_alloc wants the size to be a multiple of the alignment.
+    if (void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+} // namespace
+
+namespace XH::TEST {
+std::size_t allocation_count() noexcept
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+} // namespace XH::TEST
+
+void* operator new(std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    return counted_aligned_alloc(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return counted_aligned_alloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
@@ -0,0 +1,53 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "basic/coro_task.h"
+#include "basic/thread_pool.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+namespace {
+constexpr int width = 64;
+constexpr int rounds = 256;
+constexpr long expected_sum = long{rounds} * width * (width - 1) / 2;
+
+task<int> hop(base_thread_pool_t& pool, const int value)
+{
+    co_await pool.schedule();
+    co_return value;
+}
+
+// A pipeline stage that fans out `width` children per round, like a request handler would.
+task<long> fan_out(base_thread_pool_t& pool)
+{
+    long sum = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        std::vector<task<int>> children;
+        children.reserve(width);
+        for (int i = 0; i < width; ++i)
+            children.push_back(hop(pool, i));
+        for (const int value : co_await when_all(std::move(children)))
+            sum += value;
+    }
+    co_return sum;
+}
+} // namespace
+
+TEST(CoroTaskBench, DISABLED_ScheduleHopAndFrameAllocations)
+{
+    base_thread_pool_t pool(std::max(1u, std::thread::hardware_concurrency()));
+    // The first round warms the frame freelists and the queues.
+    EXPECT_EQ(sync_wait(fan_out(pool)), expected_sum);
+    const std::size_t before = allocation_count();
+    long sum = 0;
+    const auto ns = elapsed_ns([&] { sum = sync_wait(fan_out(pool)); });
+    EXPECT_EQ(sum, expected_sum);
+    constexpr double coroutines = double{rounds} * width;
+    std::cout << "schedule + when_all: " << static_cast<double>(ns) / coroutines << " ns/coroutine, "
+              << static_cast<double>(allocation_count() - before) / coroutines << " mallocs/coroutine" << std::endl;
+}
+} // namespace XH::TEST
@@ -0,0 +1,57 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "basic/thread_pool.h"
+#include "test_util.h"
+#include <array>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+
+namespace XH::TEST {
+namespace {
+constexpr std::size_t submits = 100000;
+
+// Submits `submits` tasks carrying a Capture-sized payload while the only worker is parked,
+// then releases it. Returns the heap allocations per submit, worker side included.
+template <std::size_t Capture>
+double mallocs_per_submit(base_thread_pool_t& pool)
+{
+    std::atomic<std::size_t> sink{0};
+    auto run = [&]
+    {
+        std::atomic<bool> gate{false};
+        pool.submit_task([&gate]
+        {
+            while (!gate.load())
+                std::this_thread::yield();
+        });
+        for (std::size_t i = 0; i < submits; ++i)
+        {
+            std::array<uint8_t, Capture - sizeof(void*)> payload{};
+            payload[0] = static_cast<uint8_t>(i);
+            pool.submit_task([&sink, payload] { sink.fetch_add(payload[0], std::memory_order_relaxed); });
+        }
+        gate = true;
+        pool.wait();
+    };
+    // The first round grows the queue to its peak depth, the second one must reuse it.
+    run();
+    const std::size_t before = allocation_count();
+    run();
+    return static_cast<double>(allocation_count() - before) / submits;
+}
+} // namespace
+
+TEST(InplaceTaskBench, DISABLED_MallocsPerSubmit)
+{
+    base_thread_pool_t pool(1);
+    std::cout << "task_t inline capacity " << task_t::inline_size << " bytes" << std::endl;
+    std::cout << "capture 16 bytes: " << mallocs_per_submit<16>(pool) << " mallocs/submit" << std::endl;
+    std::cout << "capture 32 bytes: " << mallocs_per_submit<32>(pool) << " mallocs/submit" << std::endl;
+    const double at_capacity = mallocs_per_submit<task_t::inline_size>(pool);
+    std::cout << "capture " << task_t::inline_size << " bytes: " << at_capacity << " mallocs/submit" << std::endl;
+    std::cout << "capture " << task_t::inline_size + 8 << " bytes: " << mallocs_per_submit<task_t::inline_size + 8>(pool) << " mallocs/submit (heap fallback)" << std::endl;
+    EXPECT_EQ(at_capacity, 0.0);
+}
+} // namespace XH::TEST
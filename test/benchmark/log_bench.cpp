@@ -0,0 +1,235 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "basic/log.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+namespace XH::TEST {
+namespace {
+std::filesystem::path bench_log_path()
+{
+    auto cwd = getcwd(NULL, 0);
+    std::filesystem::path fullPath(cwd);
+    free(cwd);
+    return fullPath.append("test/ts_log/bench_log");
+}
+
+void remove_bench_log(const std::filesystem::path& fullPath)
+{
+    std::filesystem::remove(fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now()));
+}
+} // namespace
+
+TEST(LogBench, DISABLED_WriterThreadThroughput)
+{
+    const std::filesystem::path fullPath = bench_log_path();
+    constexpr int lines = 1 << 20;
+    for (const int threads : {1, 4})
+    {
+        Log::GetInstance().Init(fullPath.c_str(), 256, 0, 1 << 20, OverflowPolicy::Block);
+        const auto ns = elapsed_ns([threads]
+        {
+            std::vector<std::thread> writers;
+            for (int t = 0; t < threads; ++t)
+            {
+                writers.emplace_back([threads]
+                {
+                    for (int i = 0; i < lines / threads; ++i)
+                        LOG_INFO("request {} served in {} us", i, i % 1000);
+                });
+            }
+            for (std::thread& writer : writers)
+                writer.join();
+            Log::GetInstance().Flush();
+        });
+        Log::GetInstance().Stop();
+        std::cout << threads << " threads: " << static_cast<double>(lines) * 1e3 / static_cast<double>(ns)
+                  << " M lines/s to disk" << std::endl;
+        remove_bench_log(fullPath);
+    }
+}
+
+// Every thread logs 1M lines; reports the latency of a single LOG_INFO call as seen by the caller.
+TEST(LogBench, DISABLED_PerCallLatency)
+{
+    const std::filesystem::path fullPath = bench_log_path();
+    constexpr int lines = 1 << 20;
+    for (const int threads : {1, 2, 4, 8, 16, 32})
+    {
+        Log::GetInstance().Init(fullPath.c_str(), 256, 0, 1 << 20, OverflowPolicy::Block);
+        std::vector<std::vector<uint32_t>> latencies(threads);
+        const auto ns = elapsed_ns([&latencies, threads]
+        {
+            std::vector<std::thread> writers;
+            for (int t = 0; t < threads; ++t)
+            {
+                writers.emplace_back([&samples = latencies[t]]
+                {
+                    samples.reserve(lines);
+                    for (int i = 0; i < lines; ++i)
+                    {
+                        const auto start = std::chrono::steady_clock::now();
+                        LOG_INFO("request {} served in {} us", i, i % 1000);
+                        samples.push_back(static_cast<uint32_t>((std::chrono::steady_clock::now() - start).count()));
+                    }
+                });
+            }
+            for (std::thread& writer : writers)
+                writer.join();
+            Log::GetInstance().Flush();
+        });
+        Log::GetInstance().Stop();
+        remove_bench_log(fullPath);
+
+        std::vector<uint32_t> all;
+        all.reserve(static_cast<size_t>(threads) * lines);
+        for (const std::vector<uint32_t>& samples : latencies)
+            all.insert(all.end(), samples.begin(), samples.end());
+        auto percentile = [&all](const double q)
+        {
+            auto it = all.begin() + static_cast<std::ptrdiff_t>(q * static_cast<double>(all.size() - 1));
+            std::nth_element(all.begin(), it, all.end());
+            return *it;
+        };
+        std::cout << threads << " threads: " << static_cast<double>(all.size()) * 1e3 / static_cast<double>(ns)
+                  << " M lines/s, p50 " << percentile(0.5) << " ns, p99 " << percentile(0.99) << " ns, p99.9 "
+                  << percentile(0.999) << " ns, max " << percentile(1.0) << " ns, dropped "
+                  << Log::GetInstance().Dropped() << std::endl;
+    }
+}
+
+// Single thread, 1M calls each: formatting at the call site (WriteLog) vs recording the format id and
+// raw arguments (LOG_INFO) in text and binary mode. The writer thread formats or copies in the background.
+TEST(LogBench, DISABLED_DeferredFormatting)
+{
+    const std::filesystem::path fullPath = bench_log_path();
+    constexpr int lines = 1 << 20;
+    auto run = [&fullPath](const char* name, const LogMode mode, auto&& call)
+    {
+        Log::GetInstance().Init(fullPath.c_str(), 256, 0, 16 << 20, OverflowPolicy::Block, mode);
+        std::vector<uint32_t> samples;
+        samples.reserve(lines);
+        for (int i = 0; i < lines; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            call(i);
+            samples.push_back(static_cast<uint32_t>((std::chrono::steady_clock::now() - start).count()));
+        }
+        Log::GetInstance().Stop();
+        std::filesystem::remove(fmt::format("{}_{:%Y-%m-%d}{}", fullPath.c_str(), std::chrono::system_clock::now(),
+                                            mode == LogMode::Binary ? ".bin" : ""));
+        std::nth_element(samples.begin(), samples.begin() + lines / 2, samples.end());
+        const uint32_t p50 = samples[lines / 2];
+        std::nth_element(samples.begin(), samples.begin() + lines * 99 / 100, samples.end());
+        std::cout << name << ": p50 " << p50 << " ns, p99 " << samples[lines * 99 / 100] << " ns" << std::endl;
+    };
+    run("eager WriteLog", LogMode::Text, [](int i) { Log::GetInstance().WriteLog(1, "request {} served in {} us", i, i % 1000); });
+    run("deferred LOG_INFO, text file", LogMode::Text, [](int i) { LOG_INFO("request {} served in {} us", i, i % 1000); });
+    run("deferred LOG_INFO, binary file", LogMode::Binary, [](int i) { LOG_INFO("request {} served in {} us", i, i % 1000); });
+}
+
+// Writer-side cost of one text line: timestamp formatted from scratch for every line vs the LogClock cache.
+TEST(LogBench, DISABLED_TimestampFormatting)
+{
+    constexpr int lines = 1 << 20;
+    std::string out;
+    const uint64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string args = [] {
+        fmt::memory_buffer buf;
+        LogCodec::Encode(buf, 42);
+        return std::string(buf.data(), buf.size());
+    }();
+    const auto uncached = elapsed_ns([&]
+    {
+        for (int i = 0; i < lines; ++i)
+        {
+            out.clear();
+            const auto tp = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(start + i * 1000)));
+            const std::string time = fmt::format("{:%Y-%m-%d:%H:%M}", tp);
+            LogCodec::FormatLine(out, 1, time, "request {}", args);
+        }
+    });
+    for (const LogTimePrecision precision : {LogTimePrecision::Minute, LogTimePrecision::Microsecond})
+    {
+        LogClock clock(precision);
+        const auto cached = elapsed_ns([&]
+        {
+            for (int i = 0; i < lines; ++i)
+            {
+                out.clear();
+                LogCodec::FormatLine(out, 1, clock.Format(start + i * 1000), "request {}", args);
+            }
+        });
+        std::cout << (precision == LogTimePrecision::Minute ? "LogClock minute: " : "LogClock microsecond: ")
+                  << static_cast<double>(cached) / lines << " ns/line" << std::endl;
+    }
+    std::cout << "fmt chrono per line: " << static_cast<double>(uncached) / lines << " ns/line" << std::endl;
+}
+// Output stage only, as the writer thread drives it: 256-line batches (~18KB) appended with one write()
+// vs memcpy into a LogMmapFile window, synced every 4MB like the default sync policy. 10 GB/hour is
+// ~2.8MB/s, so the CPU cost is also shown as the share of one core that rate would need.
+TEST(LogBench, DISABLED_MmapVsWriteOutput)
+{
+    const std::filesystem::path path = bench_log_path().concat("_output");
+    constexpr size_t total = 512 << 20;
+    constexpr size_t syncBytes = 4 << 20;
+    constexpr double rate = 10e9 / 3600;
+    std::string batch;
+    for (int i = 0; batch.size() < 18000; ++i)
+        batch += fmt::format("[I] | 2023-09-22:16:31 |request {} served in {} us\n", i, i % 1000);
+    auto cpu_ns = []
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    };
+    auto run = [&](const char* name, const bool mmapped)
+    {
+        std::filesystem::remove(path);
+        const int fd = ::open(path.c_str(), mmapped ? O_RDWR | O_CREAT : O_WRONLY | O_CREAT | O_APPEND, 0644);
+        ASSERT_GE(fd, 0);
+        LogMmapFile file;
+        if (mmapped)
+            file.Attach(fd, true);
+        const int64_t cpu = cpu_ns();
+        const auto ns = elapsed_ns([&]
+        {
+            size_t unsynced = 0;
+            for (size_t written = 0; written < total; written += batch.size())
+            {
+                if (mmapped)
+                    file.Append(batch);
+                else
+                    ASSERT_EQ(::write(fd, batch.data(), batch.size()), static_cast<ssize_t>(batch.size()));
+                unsynced += batch.size();
+                if (unsynced >= syncBytes)
+                {
+                    if (mmapped)
+                        file.Sync();
+                    else
+                        fsync(fd);
+                    unsynced = 0;
+                }
+            }
+            file.Detach();
+        });
+        const double cpuPerByte = static_cast<double>(cpu_ns() - cpu) / total;
+        ::close(fd);
+        std::filesystem::remove(path);
+        std::cout << name << ": " << static_cast<double>(total) * 1e3 / static_cast<double>(ns) << " MB/s, cpu "
+                  << cpuPerByte * 1e6 << " ns/MB, " << cpuPerByte * rate / 1e7 << "% of a core at 10 GB/hour" << std::endl;
+    };
+    run("write", false);
+    run("mmap", true);
+}
+} // namespace XH::TEST
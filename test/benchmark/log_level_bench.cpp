@@ -0,0 +1,49 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+
+// LOG_DEBUG is compiled out in this file, LOG_INFO is turned off at runtime below.
+#define XH_LOG_MIN_LEVEL 1
+#include "basic/log.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace XH::TEST {
+namespace {
+int evaluations = 0;
+
+[[gnu::noinline]] int expensive_argument(const int i)
+{
+    ++evaluations;
+    return i * 7;
+}
+} // namespace
+
+TEST(LogLevelBench, DISABLED_DisabledStatementCost)
+{
+    auto cwd = getcwd(NULL, 0);
+    std::filesystem::path fullPath(cwd);
+    free(cwd);
+    fullPath.append("test/ts_log/level_bench_log");
+    Log::GetInstance().Init(fullPath.c_str(), 256, 2);
+
+    constexpr int calls = 100'000'000;
+    const auto compiled_out = elapsed_ns([]
+    {
+        for (int i = 0; i < calls; ++i)
+            LOG_DEBUG("value {} of {}", expensive_argument(i), i);
+    });
+    const auto runtime_off = elapsed_ns([]
+    {
+        for (int i = 0; i < calls; ++i)
+            LOG_INFO("value {} of {}", expensive_argument(i), i);
+    });
+    EXPECT_EQ(evaluations, 0);
+    Log::GetInstance().Stop();
+    std::filesystem::remove(fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now()));
+
+    std::cout << "compiled out (XH_LOG_MIN_LEVEL): " << static_cast<double>(compiled_out) / calls << " ns/statement" << std::endl;
+    std::cout << "disabled at runtime: " << static_cast<double>(runtime_off) / calls << " ns/statement" << std::endl;
+}
+} // namespace XH::TEST
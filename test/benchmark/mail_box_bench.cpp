@@ -0,0 +1,79 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "basic/mail_box.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace XH::TEST {
+namespace {
+// Receive side only: each round queues a burst of 64-byte datagrams in the socket buffer, then times
+// the event loop handing them to the handler. Sender and receiver don't compete for the cpu, so the
+// rate is what the receive path can sustain.
+template <typename Register>
+void run_pps(const char* name, const int port, const size_t batch_size, Register&& regist)
+{
+    constexpr int rounds = 256;
+    constexpr int burst = 2048;
+    const std::string ip = "127.0.0.1";
+    mail_box box(batch_size);
+    ASSERT_EQ(box.bind(ip, port), 0);
+    const int rcvbuf = 16 << 20;
+    setsockopt(box.get_sock(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    uint64_t received = 0;
+    regist(box, received);
+
+    struct event_base* base = event_base_new();
+    ASSERT_NE(base, nullptr);
+    box.add_event(base);
+
+    mail_sender sender;
+    uint8_t payload[64] = {};
+    uint64_t sent = 0;
+    int64_t ns = 0;
+    size_t allocations = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (int i = 0; i < burst; ++i)
+            sent += sender.send(ip, port, std::span<const uint8_t>(payload, sizeof(payload))) > 0;
+        // Stop once a pass finds nothing new, in case the kernel dropped part of the burst.
+        const size_t before_round = allocation_count();
+        ns += elapsed_ns([&]
+        {
+            for (uint64_t before = ~0ull; received < sent && received != before;)
+            {
+                before = received;
+                event_base_loop(base, EVLOOP_NONBLOCK);
+            }
+        });
+        // The first round warms up the msg_buf pool.
+        if (r > 0)
+            allocations += allocation_count() - before_round;
+    }
+    box.remove_event();
+    event_base_free(base);
+
+    std::cout << name << ": " << static_cast<double>(received) * 1e3 / static_cast<double>(ns) << " M pps, "
+              << static_cast<double>(ns) / static_cast<double>(received) << " ns/datagram, " << sent - received
+              << " dropped, " << allocations << " mallocs after warm-up" << std::endl;
+}
+} // namespace
+
+TEST(MailBoxBench, DISABLED_LoopbackPps)
+{
+    run_pps("recvmmsg x1, pooled msg_buf per datagram", 12450, 1, [](mail_box& box, uint64_t& received)
+    {
+        box.regist_handler([&received](mail_box*, msg_ptr&&) { ++received; });
+    });
+    run_pps("recvmmsg x32, pooled msg_buf per datagram", 12451, 32, [](mail_box& box, uint64_t& received)
+    {
+        box.regist_handler([&received](mail_box*, msg_ptr&&) { ++received; });
+    });
+    run_pps("recvmmsg x32, batch handler", 12452, 32, [](mail_box& box, uint64_t& received)
+    {
+        box.regist_batch_handler([&received](mail_box*, std::span<const msg_view> msgs) { received += msgs.size(); });
+    });
+}
+} // namespace XH::TEST
@@ -0,0 +1,73 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "mpmc_queue.h"
+#include "test_util.h"
+#include "thread_safe_queue.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+namespace {
+constexpr int bench_items = 1 << 20;
+
+// Half the threads push, half pop (one thread does both), until bench_items went through.
+template <typename Queue>
+double items_per_second(Queue& queue, const int threads)
+{
+    const int producers = std::max(1, threads / 2);
+    const int consumers = std::max(1, threads - producers);
+    std::atomic<int> consumed{0};
+    const auto ns = elapsed_ns([&]
+    {
+        if (threads == 1)
+        {
+            for (int i = 0; i < bench_items; ++i)
+            {
+                queue.Push(i);
+                queue.Pop();
+            }
+            consumed = bench_items;
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int p = 0; p < producers; ++p)
+        {
+            workers.emplace_back([&queue, p, producers]
+            {
+                for (int i = p; i < bench_items; i += producers)
+                    queue.Push(i);
+            });
+        }
+        for (int c = 0; c < consumers; ++c)
+        {
+            workers.emplace_back([&queue, &consumed]
+            {
+                while (consumed.load(std::memory_order_relaxed) < bench_items)
+                {
+                    if (queue.Pop(1))
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (std::thread& worker : workers)
+            worker.join();
+    });
+    EXPECT_EQ(consumed.load(), bench_items);
+    return static_cast<double>(bench_items) * 1e9 / static_cast<double>(ns);
+}
+} // namespace
+
+TEST(MpmcQueueBench, DISABLED_ScalingVsThreadSafeQueue)
+{
+    for (const int threads : {1, 2, 4, 8, 16, 32})
+    {
+        ThreadSafeQueue<int> locked;
+        MpmcQueue<int> lock_free(4096);
+        std::cout << "threads " << threads << ": ThreadSafeQueue " << items_per_second(locked, threads) / 1e6
+                  << " M items/s, MpmcQueue " << items_per_second(lock_free, threads) / 1e6 << " M items/s" << std::endl;
+    }
+}
+} // namespace XH::TEST
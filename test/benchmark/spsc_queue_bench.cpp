@@ -0,0 +1,113 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "basic/thread.h"
+#include "mpmc_queue.h"
+#include "spsc_queue.h"
+#include "test_util.h"
+#include "thread_safe_queue.h"
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+namespace {
+constexpr int bench_items = 1 << 22;
+
+// Producer and consumer pinned to two different physical cores when the machine has them.
+std::vector<std::size_t> bench_cpus()
+{
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+    return placement_cpus({placement_policy::scatter}, read_cpu_topology(), 2);
+#else
+    return {};
+#endif
+}
+
+void pin(const std::vector<std::size_t>& cpus, const std::size_t idx)
+{
+#ifdef XH_THREAD_POOL_NATIVE_EXTENTIONS
+    if (idx < cpus.size())
+        this_thread::pin_to_cpu(cpus[idx]);
+#else
+    (void)cpus;
+    (void)idx;
+#endif
+}
+
+// One producer, one consumer, both spinning on the non-blocking calls. Returns ns per item.
+template <typename Push, typename Pop>
+double ns_per_item(Push push, Pop pop)
+{
+    const std::vector<std::size_t> cpus = bench_cpus();
+    // Sharing one cpu, spinning only burns the other side's time slice.
+    const bool shared_cpu = cpus.size() < 2 || cpus[0] == cpus[1];
+    auto backoff = [shared_cpu]
+    {
+        if (shared_cpu)
+            std::this_thread::yield();
+        else
+            cpu_relax();
+    };
+    long sum = 0;
+    const auto ns = elapsed_ns([&]
+    {
+        std::thread producer([&]
+        {
+            pin(cpus, 0);
+            for (int i = 0; i < bench_items;)
+            {
+                if (push(i))
+                    ++i;
+                else
+                    backoff();
+            }
+        });
+        // The consumer gets its own thread too: pinning the gtest main thread would leak into
+        // every benchmark that runs after this one.
+        std::thread consumer([&]
+        {
+            pin(cpus, 1);
+            for (int received = 0; received < bench_items;)
+            {
+                if (std::optional<int> value = pop())
+                {
+                    sum += *value;
+                    ++received;
+                }
+                else
+                {
+                    backoff();
+                }
+            }
+        });
+        producer.join();
+        consumer.join();
+    });
+    EXPECT_EQ(sum, long{bench_items} * (bench_items - 1) / 2);
+    return static_cast<double>(ns) / bench_items;
+}
+
+void report(const char* name, const double ns)
+{
+    std::cout << name << ": " << ns << " ns/op, " << 1e3 / ns << " M items/s" << std::endl;
+}
+} // namespace
+
+TEST(SpscQueueBench, DISABLED_TwoPinnedCores)
+{
+    std::cout << "cpus:";
+    for (const std::size_t cpu : bench_cpus())
+        std::cout << ' ' << cpu;
+    std::cout << std::endl;
+
+    SpscQueue<int, 4096> spsc;
+    report("SpscQueue", ns_per_item([&spsc](int i) { return spsc.TryPush(i); }, [&spsc] { return spsc.TryPop(); }));
+
+    MpmcQueue<int> mpmc(4096);
+    report("MpmcQueue", ns_per_item([&mpmc](int i) { return mpmc.TryPush(i); }, [&mpmc] { return mpmc.TryPop(); }));
+
+    ThreadSafeQueue<int> locked(4096);
+    report("ThreadSafeQueue", ns_per_item([&locked](int i) { return locked.TryPush(i); }, [&locked] { return locked.Pop(); }));
+}
+} // namespace XH::TEST
@@ -0,0 +1,136 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "basic/thread_pool.h"
+#include "test_util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace XH::TEST {
+namespace {
+constexpr std::size_t bench_tasks = 1 << 20;
+constexpr std::size_t bench_roots = 64;
+
+// Tiny tasks pushed from outside the pool: every submit goes through the producer side.
+template <topt_t opts>
+double external_submit_ns_per_task(std::size_t threads)
+{
+    std::atomic<std::size_t> counter{0};
+    thread_pool<opts> pool(threads);
+    const auto ns = elapsed_ns([&]
+    {
+        for (std::size_t i = 0; i < bench_tasks; ++i)
+            pool.submit_task([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+        pool.wait();
+    });
+    EXPECT_EQ(counter.load(), bench_tasks);
+    return static_cast<double>(ns) / bench_tasks;
+}
+
+// Tiny tasks spawned by tasks already running on the pool (recursive fan-out).
+template <topt_t opts>
+double fan_out_ns_per_task(std::size_t threads)
+{
+    std::atomic<std::size_t> counter{0};
+    thread_pool<opts> pool(threads);
+    const auto ns = elapsed_ns([&]
+    {
+        for (std::size_t r = 0; r < bench_roots; ++r)
+        {
+            pool.submit_task([&]
+            {
+                for (std::size_t i = 0; i < bench_tasks / bench_roots; ++i)
+                    pool.submit_task([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+            });
+        }
+        pool.wait();
+    });
+    EXPECT_EQ(counter.load(), bench_tasks);
+    return static_cast<double>(ns) / bench_tasks;
+}
+} // namespace
+
+TEST(ThreadPoolBench, DISABLED_GlobalQueueVsWorkStealing)
+{
+    const std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        std::cout << "threads " << threads
+                  << " | external submit ns/task: global " << external_submit_ns_per_task<topt_t::none>(threads)
+                  << ", stealing " << external_submit_ns_per_task<topt_t::work_stealing>(threads)
+                  << " | fan-out ns/task: global " << fan_out_ns_per_task<topt_t::none>(threads)
+                  << ", stealing " << fan_out_ns_per_task<topt_t::work_stealing>(threads) << std::endl;
+    }
+}
+
+TEST(ThreadPoolBench, DISABLED_StatsOverhead)
+{
+    const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "external submit ns/task: global " << external_submit_ns_per_task<topt_t::none>(threads)
+              << ", global + stats " << external_submit_ns_per_task<topt_t::stats>(threads)
+              << " | fan-out ns/task: stealing " << fan_out_ns_per_task<topt_t::work_stealing>(threads)
+              << ", stealing + stats " << fan_out_ns_per_task<topt_t::work_stealing | topt_t::stats>(threads) << std::endl;
+}
+
+TEST(ThreadPoolBench, DISABLED_SubmitBulkThroughput)
+{
+    constexpr std::size_t total = 1 << 20;
+    const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    for (const std::size_t batch_size : {1, 8, 64, 512})
+    {
+        std::atomic<std::size_t> counter{0};
+        base_thread_pool_t pool(threads);
+        std::vector<task_t> batch(batch_size);
+        const auto ns = elapsed_ns([&]
+        {
+            for (std::size_t sent = 0; sent < total; sent += batch_size)
+            {
+                for (task_t& task : batch)
+                    task = [&counter] { counter.fetch_add(1, std::memory_order_relaxed); };
+                pool.submit_bulk(batch);
+            }
+            pool.wait();
+        });
+        EXPECT_EQ(counter.load(), total);
+        std::cout << "batch " << batch_size << ": " << static_cast<double>(total) * 1e9 / ns << " tasks/s" << std::endl;
+    }
+}
+
+TEST(ThreadPoolBench, DISABLED_IdleStrategyWakeLatency)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr std::size_t samples = 2000;
+    const std::size_t threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    const std::pair<idle_strategy, const char*> strategies[] = {
+        {idle_strategy::block, "block"},
+        {idle_strategy::spin_then_block, "spin_then_block"},
+        {idle_strategy::busy_poll, "busy_poll"},
+    };
+    for (const auto& [strategy, name] : strategies)
+    {
+        base_thread_pool_t pool(threads);
+        pool.set_idle_strategy(strategy);
+        std::vector<std::int64_t> latencies(samples);
+        for (std::size_t i = 0; i < samples; ++i)
+        {
+            const auto submitted = clock::now();
+            pool.submit_task([&latencies, i, submitted]
+            {
+                latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - submitted).count();
+            });
+            pool.wait();
+            // Sparse arrivals: the workers are idle again when the next task comes in.
+            const auto gap_end = clock::now() + std::chrono::microseconds(20);
+            while (clock::now() < gap_end)
+                cpu_relax();
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << name << ": submit-to-start p50 " << latencies[samples / 2] << " ns, p99 " << latencies[samples * 99 / 100] << " ns" << std::endl;
+    }
+}
+} // namespace XH::TEST
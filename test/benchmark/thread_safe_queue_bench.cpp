@@ -0,0 +1,86 @@
+// Benchmarks are disabled by default, run them with:
+//   targetX --gtest_also_run_disabled_tests --gtest_filter='*Bench*'
+#include "test_util.h"
+#include "thread_safe_queue.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace XH::TEST {
+namespace {
+constexpr std::size_t bench_items = 1 << 19;
+
+std::atomic<std::size_t> g_copies{0};
+
+// A log-line sized payload that counts how often it gets copied.
+struct Counted {
+    Counted() = default;
+    explicit Counted(std::string text) : text(std::move(text)) {}
+    Counted(const Counted& other) : text(other.text) { g_copies.fetch_add(1, std::memory_order_relaxed); }
+    Counted(Counted&&) noexcept = default;
+    Counted& operator=(const Counted& other)
+    {
+        g_copies.fetch_add(1, std::memory_order_relaxed);
+        text = other.text;
+        return *this;
+    }
+    Counted& operator=(Counted&&) noexcept = default;
+
+    std::string text;
+};
+
+// One producer pushing through @push, one consumer draining with Pop or PopBulk(@batch).
+template <typename PushF>
+double items_per_second(PushF&& push, const std::size_t batch)
+{
+    ThreadSafeQueue<Counted> queue;
+    const auto ns = elapsed_ns([&]
+    {
+        std::thread consumer([&queue, batch]
+        {
+            std::vector<Counted> out;
+            out.reserve(batch);
+            for (std::size_t got = 0; got < bench_items;)
+            {
+                if (batch == 1)
+                {
+                    got += queue.Pop(-1).has_value();
+                }
+                else
+                {
+                    got += queue.PopBulk(std::back_inserter(out), batch, -1);
+                    out.clear();
+                }
+            }
+        });
+        for (std::size_t i = 0; i < bench_items; ++i)
+            push(queue);
+        consumer.join();
+    });
+    return static_cast<double>(bench_items) * 1e9 / static_cast<double>(ns);
+}
+} // namespace
+
+TEST(ThreadSafeQueueBench, DISABLED_CopiesAndBatchThroughput)
+{
+    const Counted line("[I] | 2024-01-01:00:00 | a typical log line that does not fit in SSO");
+    auto by_copy = [&line](ThreadSafeQueue<Counted>& queue) { queue.Push(line); };
+    auto by_move = [&line](ThreadSafeQueue<Counted>& queue) { queue.Push(Counted(line.text)); };
+    auto by_emplace = [&line](ThreadSafeQueue<Counted>& queue) { queue.Emplace(line.text); };
+
+    g_copies = 0;
+    const double copy_rate = items_per_second(by_copy, 1);
+    std::cout << "Push(const T&): " << static_cast<double>(g_copies.exchange(0)) / bench_items << " copies/item, " << copy_rate / 1e6 << " M items/s" << std::endl;
+    const double move_rate = items_per_second(by_move, 1);
+    std::cout << "Push(T&&):      " << static_cast<double>(g_copies.exchange(0)) / bench_items << " copies/item, " << move_rate / 1e6 << " M items/s" << std::endl;
+    const double emplace_rate = items_per_second(by_emplace, 1);
+    std::cout << "Emplace:        " << static_cast<double>(g_copies.exchange(0)) / bench_items << " copies/item, " << emplace_rate / 1e6 << " M items/s" << std::endl;
+    for (const std::size_t batch : {16, 256})
+        std::cout << "Emplace + PopBulk(" << batch << "): " << items_per_second(by_emplace, batch) / 1e6 << " M items/s" << std::endl;
+    EXPECT_EQ(g_copies.load(), 0);
+}
+} // namespace XH::TEST
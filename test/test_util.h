@@ -3,6 +3,7 @@
 
 #include <thread>
 #include <chrono>
+#include <cstdint>
 #include <gtest/gtest.h>
 
 #define EXPECT_TRUE_FOR_X_MS(time, cond)                                \
@@ -19,4 +20,18 @@
         EXPECT_TRUE((cond));                                            \
     }
 
+namespace XH::TEST {
+// Wall-clock nanoseconds spent in func, used by the benchmark cases.
+template <typename F>
+inline std::int64_t elapsed_ns(F&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Number of global operator new calls so far (test/benchmark/alloc_counter.cpp).
+std::size_t allocation_count() noexcept;
+} // namespace XH::TEST
+
 #endif
\ No newline at end of file
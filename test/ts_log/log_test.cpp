@@ -1,9 +1,20 @@
 #include "basic/log.h"
+#include "basic/log_sink.h"
 #include <gtest/gtest.h>
+#include <atomic>
 #include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <condition_variable>
+#include <mutex>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <regex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 // void deleteDirectory(const std::filesystem::path& dir);
 void deleteFile(const std::filesystem::path& file);
@@ -33,6 +44,581 @@ TEST(Log, FmtTest)
     deleteFile(f1);
 }
 
+TEST(Log, FlushWaitsForWriterThread)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+
+    fullPath.append("test/ts_log/flush_log");
+
+    constexpr int threads = 4;
+    constexpr int perThread = 2000;
+    // Long interval and large byte threshold: only Flush() forces the fsync here.
+    Log::GetInstance().SetSyncPolicy(std::chrono::seconds(60), 64 << 20);
+    Log::GetInstance().Init(fullPath.c_str(), 64, 0, 16 << 10, OverflowPolicy::Block);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t)
+    {
+        writers.emplace_back([t]
+        {
+            for (int i = 0; i < perThread; ++i)
+                LOG_INFO("writer {} line {}", t, i);
+        });
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+    Log::GetInstance().Flush();
+
+    std::string f1 = fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now());
+    std::ifstream in(f1);
+    int lines = 0;
+    for (std::string line; std::getline(in, line);)
+        ++lines;
+    EXPECT_EQ(lines, threads * perThread);
+    EXPECT_EQ(Log::GetInstance().Dropped(), 0);
+
+    Log::GetInstance().Stop();
+    Log::GetInstance().SetSyncPolicy(std::chrono::seconds(1), 4 << 20);
+    deleteFile(f1);
+}
+
+TEST(Log, RingWrapsWithContiguousRecords)
+{
+    LogRing ring(4096);
+    EXPECT_EQ(ring.Capacity(), 4096);
+    std::string line(150, 'x');
+    LogRing::Entry entry;
+    // 176 bytes per record: the ring wraps many times and needs a filler record at the end.
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        line[0] = static_cast<char>('a' + i % 26);
+        ASSERT_TRUE(ring.TryWrite(i, line));
+        ASSERT_TRUE(ring.Front(entry));
+        EXPECT_EQ(entry.ts, i);
+        EXPECT_EQ(entry.msg, line);
+        ring.Pop();
+    }
+    EXPECT_FALSE(ring.Front(entry));
+
+    int written = 0;
+    while (ring.TryWrite(written, line))
+        ++written;
+    // The filler record in front of the wrap point may cost one record.
+    EXPECT_GE(written, 4096 / 176 - 1);
+    EXPECT_LE(written, 4096 / 176);
+    for (int i = 0; i < written; ++i)
+    {
+        ASSERT_TRUE(ring.Front(entry));
+        EXPECT_EQ(entry.ts, static_cast<uint64_t>(i));
+        ring.Pop();
+    }
+
+    // Oversized records are rejected whole, truncating would corrupt binary arguments.
+    EXPECT_FALSE(ring.TryWrite(0, std::string(ring.MaxMessage() + 1, 'y')));
+    EXPECT_FALSE(ring.Front(entry));
+    ASSERT_TRUE(ring.TryWrite(0, std::string(ring.MaxMessage(), 'y')));
+    ASSERT_TRUE(ring.Front(entry));
+    EXPECT_EQ(entry.msg.size(), ring.MaxMessage());
+}
+
+TEST(Log, OversizedRecordIsDroppedWhole)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/oversize_log");
+
+    // Block policy: an oversized record must not wait forever for room that never comes.
+    Log::GetInstance().Init(fullPath.c_str(), 16, 0, 4096, OverflowPolicy::Block, LogMode::Binary);
+    std::thread writer([]
+    {
+        std::string big(4096, 'y');
+        LOG_INFO("big {} end", big);
+        LOG_INFO("after {}", 1);
+    });
+    writer.join();
+    Log::GetInstance().Stop();
+    EXPECT_EQ(Log::GetInstance().Dropped(), 1);
+
+    std::string f = fmt::format("{}_{:%Y-%m-%d}.bin", fullPath.c_str(), std::chrono::system_clock::now());
+    std::ifstream in(f, std::ios::binary);
+    std::stringstream decoded;
+    EXPECT_TRUE(LogCodec::Decode(in, decoded));
+    EXPECT_EQ(decoded.str().find("big"), std::string::npos);
+    EXPECT_NE(decoded.str().find("|after 1\n"), std::string::npos);
+    deleteFile(f);
+}
+
+TEST(Log, BinaryModeDecodesToSameText)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/binary_log");
+
+    auto writeAll = []
+    {
+        const std::string name = "mail_box";
+        const int* nothing = nullptr;
+        LOG_INFO("ints {} {} {:#x}", -5, 7u, uint64_t{255});
+        LOG_WARN("float {:.2f} char {} bool {}", 3.14159, 'c', true);
+        LOG_ERROR("strings {} {} {}", name, "literal", std::string_view("view"));
+        LOG_INFO("pointer {}", static_cast<const void*>(nothing));
+        LOG_INFO("extra args are ignored: %s", name);
+        Log::GetInstance().WriteLog(2, "runtime {}", 42);
+    };
+
+    std::string text;
+    {
+        Log::GetInstance().Init(fullPath.c_str(), 16, 0);
+        writeAll();
+        Log::GetInstance().Stop();
+        std::string f = fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now());
+        std::ifstream in(f);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        text = ss.str();
+        deleteFile(f);
+    }
+    EXPECT_NE(text.find("|ints -5 7 0xff\n"), std::string::npos);
+    EXPECT_NE(text.find("[W] | "), std::string::npos);
+    EXPECT_NE(text.find("|float 3.14 char c bool true\n"), std::string::npos);
+    EXPECT_NE(text.find("|strings mail_box literal view\n"), std::string::npos);
+    EXPECT_NE(text.find("|pointer 0x0\n"), std::string::npos);
+    EXPECT_NE(text.find("|extra args are ignored: %s\n"), std::string::npos);
+    EXPECT_NE(text.find("|runtime 42\n"), std::string::npos);
+
+    Log::GetInstance().Init(fullPath.c_str(), 16, 0, 1 << 20, OverflowPolicy::DropNewest, LogMode::Binary);
+    writeAll();
+    Log::GetInstance().Stop();
+    std::string f = fmt::format("{}_{:%Y-%m-%d}.bin", fullPath.c_str(), std::chrono::system_clock::now());
+    std::ifstream in(f, std::ios::binary);
+    std::stringstream decoded;
+    EXPECT_TRUE(LogCodec::Decode(in, decoded));
+    // Only the minute in the prefix could differ between the two runs.
+    std::regex minute(":[0-9][0-9] \\|");
+    EXPECT_EQ(std::regex_replace(decoded.str(), minute, ":MM |"), std::regex_replace(text, minute, ":MM |"));
+    deleteFile(f);
+}
+
+TEST(Log, DecodeRejectsCorruptFiles)
+{
+    auto decode = [](const std::string& file)
+    {
+        std::istringstream in(file);
+        std::ostringstream out;
+        return LogCodec::Decode(in, out);
+    };
+    std::string valid(LogCodec::MAGIC);
+    LogCodec::AppendFormatRecord(valid, 7, {1, "hello"});
+    LogCodec::AppendLogRecord(valid, 7, 0, "");
+    EXPECT_TRUE(decode(valid));
+
+    // Cut off in the middle of the pattern.
+    EXPECT_FALSE(decode(valid.substr(0, LogCodec::MAGIC.size() + 12)));
+
+    // Forged ids and lengths fail instead of writing out of bounds or allocating gigabytes.
+    auto forged = [](uint32_t id, uint32_t len)
+    {
+        std::string file(LogCodec::MAGIC);
+        file += LogCodec::FORMAT_RECORD;
+        LogCodec::Put<uint32_t>(file, id);
+        LogCodec::Put<uint8_t>(file, 1);
+        LogCodec::Put<uint32_t>(file, len);
+        file += "hello";
+        return file;
+    };
+    EXPECT_TRUE(decode(forged(7, 5)));
+    EXPECT_FALSE(decode(forged(UINT32_MAX, 5)));
+    EXPECT_FALSE(decode(forged(LogCodec::MAX_FORMAT_ID + 1, 5)));
+    EXPECT_FALSE(decode(forged(7, UINT32_MAX)));
+
+    std::string bigArgs(LogCodec::MAGIC);
+    LogCodec::AppendFormatRecord(bigArgs, 7, {1, "hello"});
+    bigArgs += LogCodec::LOG_RECORD;
+    LogCodec::Put<uint32_t>(bigArgs, 7);
+    LogCodec::Put<uint64_t>(bigArgs, 0);
+    LogCodec::Put<uint32_t>(bigArgs, UINT32_MAX - 1);
+    EXPECT_FALSE(decode(bigArgs));
+}
+
+TEST(Log, DisabledLevelSkipsArguments)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/level_log");
+
+    int evaluated = 0;
+    auto arg = [&evaluated] { return ++evaluated; };
+    Log::GetInstance().Init(fullPath.c_str(), 16, 2);
+    EXPECT_FALSE(Log::Enabled(1));
+    EXPECT_TRUE(Log::Enabled(2));
+    LOG_DEBUG("debug {}", arg());
+    LOG_INFO("info {}", arg());
+    EXPECT_EQ(evaluated, 0);
+    LOG_WARN("warn {}", arg());
+    EXPECT_EQ(evaluated, 1);
+    // Usable as a single statement.
+    if (evaluated == 1)
+        LOG_ERROR("error {}", arg());
+    else
+        LOG_ERROR("unreachable");
+    EXPECT_EQ(evaluated, 2);
+    Log::GetInstance().Stop();
+
+    std::string f1 = fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now());
+    EXPECT_TRUE(fileCompare(f1, ".*warn 1.*error 2.*"));
+    EXPECT_FALSE(fileCompare(f1, ".*info.*"));
+    deleteFile(f1);
+}
+
+TEST(Log, ClockMatchesLocalTime)
+{
+    constexpr uint64_t ns = 1000000000;
+    const uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto expected = [](uint64_t ts, const char* spec)
+    {
+        time_t sec = static_cast<time_t>(ts / ns);
+        return fmt::format(fmt::runtime(spec), fmt::localtime(sec));
+    };
+
+    LogClock clock;
+    EXPECT_EQ(clock.Format(now), expected(now, "{:%Y-%m-%d:%H:%M}"));
+    EXPECT_EQ(clock.Date(now), expected(now, "{:%Y-%m-%d}"));
+    // Whole minutes and days apart, whatever the cache currently holds.
+    for (const uint64_t step : {uint64_t{1}, 59 * ns, 61 * ns, 3600 * ns, 86400 * ns})
+    {
+        EXPECT_EQ(clock.Format(now + step), expected(now + step, "{:%Y-%m-%d:%H:%M}"));
+        EXPECT_EQ(clock.Format(now - step), expected(now - step, "{:%Y-%m-%d:%H:%M}"));
+    }
+    EXPECT_EQ(clock.Day(now + 86400 * ns), clock.Day(now) + 1);
+
+    clock.SetPrecision(LogTimePrecision::Second);
+    EXPECT_EQ(clock.Format(now), expected(now, "{:%Y-%m-%d:%H:%M:%S}"));
+    clock.SetPrecision(LogTimePrecision::Microsecond);
+    const uint64_t second = now / ns * ns;
+    EXPECT_EQ(clock.Format(second + 1234567), expected(now, "{:%Y-%m-%d:%H:%M:%S}") + ".001234");
+    EXPECT_EQ(clock.Format(second + 999999999), expected(now, "{:%Y-%m-%d:%H:%M:%S}") + ".999999");
+}
+
+TEST(Log, RotationBySizeKeepsNewestArchives)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path dir(path);
+    free(path);
+    dir.append("test/ts_log/rotate");
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::atomic<int> compressed{0};
+    LogRotation rotation;
+    rotation.maxBytes = 1024;
+    rotation.keep = 2;
+    // Stand-in for gzip: rename to *.gz.
+    rotation.compress = [&compressed](const std::filesystem::path& file)
+    {
+        std::filesystem::rename(file, file.string() + ".gz");
+        ++compressed;
+    };
+    Log::GetInstance().SetRotation(rotation);
+    Log::GetInstance().Init((dir / "rotate_log").c_str(), 16, 0);
+    for (int i = 0; i < 200; ++i)
+    {
+        LOG_INFO("rotation line {}", i);
+    }
+    Log::GetInstance().Stop();
+    Log::GetInstance().SetRotation({});
+
+    std::vector<std::filesystem::path> archives;
+    std::filesystem::path active;
+    for (const auto& entry : std::filesystem::directory_iterator(dir))
+    {
+        if (entry.path().extension() == ".gz")
+        {
+            archives.push_back(entry.path());
+        }
+        else
+        {
+            active = entry.path();
+        }
+    }
+    // ~40 bytes a line, so 200 lines fill several 1KB files.
+    EXPECT_GT(compressed.load(), 2);
+    EXPECT_EQ(archives.size(), 2u);
+    for (const auto& file : archives)
+    {
+        EXPECT_LE(std::filesystem::file_size(file), 1024u + 64);
+    }
+    EXPECT_TRUE(fileCompare(active, ".*rotation line 199.*"));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Log, RotationPrunesOnlyItsOwnArchives)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path dir(path);
+    free(path);
+    dir.append("test/ts_log/rotate_shared");
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // A second logger in the same directory whose name starts with ours. Its files are older,
+    // so a prefix match would prune them first.
+    std::string date = fmt::format("{:%Y-%m-%d}", std::chrono::system_clock::now());
+    std::vector<std::filesystem::path> others = {
+        dir / ("app_worker_" + date),
+        dir / ("app_worker_" + date + ".1.gz"),
+        dir / ("app_worker_" + date + ".2.gz"),
+        dir / "app_notes.txt",
+    };
+    for (const auto& file : others)
+    {
+        std::ofstream(file) << "other logger\n";
+        std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+    }
+
+    LogRotation rotation;
+    rotation.maxBytes = 1024;
+    rotation.keep = 2;
+    rotation.compress = [](const std::filesystem::path& file)
+    {
+        std::filesystem::rename(file, file.string() + ".gz");
+    };
+    Log::GetInstance().SetRotation(rotation);
+    Log::GetInstance().Init((dir / "app").c_str(), 16, 0);
+    for (int i = 0; i < 200; ++i)
+    {
+        LOG_INFO("rotation line {}", i);
+    }
+    Log::GetInstance().Stop();
+    Log::GetInstance().SetRotation({});
+
+    for (const auto& file : others)
+    {
+        EXPECT_TRUE(std::filesystem::exists(file)) << file;
+    }
+    size_t archives = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("app_" + date + ".", 0) == 0)
+        {
+            ++archives;
+        }
+    }
+    EXPECT_EQ(archives, 2u);
+    EXPECT_TRUE(fileCompare(dir / ("app_" + date), ".*rotation line 199.*"));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Log, MmapOutputRemapsAndTruncates)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/mmap_log");
+    std::string f1 = fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now());
+    deleteFile(f1);
+
+    // A two-page window makes the writer remap many times.
+    Log::GetInstance().SetOutput(LogOutput::Mmap, 8192);
+    Log::GetInstance().Init(fullPath.c_str(), 16, 0);
+    for (int i = 0; i < 2000; ++i)
+    {
+        LOG_INFO("mmap line {}", i);
+    }
+    Log::GetInstance().Flush();
+    Log::GetInstance().Stop();
+    Log::GetInstance().SetOutput(LogOutput::Write);
+
+    // Cut back to the bytes written, nothing left over from preallocation.
+    std::ifstream in(f1, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(text.size(), std::filesystem::file_size(f1));
+    EXPECT_EQ(text.find('\0'), std::string::npos);
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 2000);
+    EXPECT_NE(text.find("mmap line 0\n"), std::string::npos);
+    EXPECT_NE(text.find("mmap line 1999\n"), std::string::npos);
+
+    // A crashed run leaves zero-filled preallocation behind; text files resume after the last line.
+    std::filesystem::resize_file(f1, text.size() + 10000);
+    int fd = ::open(f1.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    {
+        LogMmapFile file(4096);
+        ASSERT_TRUE(file.Attach(fd, true));
+        EXPECT_EQ(file.Size(), text.size());
+        EXPECT_EQ(file.Append("resumed\n"), 8u);
+    }
+    ::close(fd);
+    EXPECT_EQ(std::filesystem::file_size(f1), text.size() + 8);
+    deleteFile(f1);
+}
+
+namespace {
+class MemorySink : public LogSink
+{
+public:
+    void Write(std::string_view lines) override
+    {
+        std::lock_guard lk(m_mut);
+        m_text += lines;
+    }
+    std::string Text()
+    {
+        std::lock_guard lk(m_mut);
+        return m_text;
+    }
+private:
+    std::mutex m_mut;
+    std::string m_text;
+};
+
+// Stuck in Write until released.
+class BlockedSink : public LogSink
+{
+public:
+    void Write(std::string_view) override
+    {
+        std::unique_lock lk(m_mut);
+        m_cv.wait(lk, [this] { return m_released; });
+    }
+    void Release()
+    {
+        std::lock_guard lk(m_mut);
+        m_released = true;
+        m_cv.notify_all();
+    }
+private:
+    std::mutex m_mut;
+    std::condition_variable m_cv;
+    bool m_released = false;
+};
+} // namespace
+
+TEST(Log, SinksFilterByLevelIndependently)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/sink_log");
+
+    auto all = std::make_shared<MemorySink>();
+    auto errors = std::make_shared<MemorySink>();
+    Log::GetInstance().Init(fullPath.c_str(), 16, 2);
+    Log::GetInstance().AddSink(all, 0);
+    Log::GetInstance().AddSink(errors, 3);
+    EXPECT_TRUE(Log::Enabled(0));
+    LOG_DEBUG("sink debug {}", 0);
+    LOG_INFO("sink info {}", 1);
+    LOG_WARN("sink warn {}", 2);
+    LOG_ERROR("sink error {}", 3);
+    Log::GetInstance().Flush();
+    Log::GetInstance().RemoveSink(all);
+    Log::GetInstance().RemoveSink(errors);
+    EXPECT_FALSE(Log::Enabled(1));
+    Log::GetInstance().Stop();
+
+    EXPECT_TRUE(std::regex_match(all->Text(), std::regex("\\[D\\][^\\n]*sink debug 0\\n\\[I\\][^\\n]*sink info 1\\n"
+                                                         "\\[W\\][^\\n]*sink warn 2\\n\\[E\\][^\\n]*sink error 3\\n")));
+    EXPECT_TRUE(std::regex_match(errors->Text(), std::regex("\\[E\\][^\\n]*sink error 3\\n")));
+    std::string f1 = fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now());
+    EXPECT_TRUE(fileCompare(f1, ".*sink warn 2.*sink error 3.*"));
+    EXPECT_FALSE(fileCompare(f1, ".*sink info.*"));
+    deleteFile(f1);
+}
+
+TEST(Log, SlowSinkDoesNotBlockOthers)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/sink_log");
+
+    auto fast = std::make_shared<MemorySink>();
+    auto slow = std::make_shared<BlockedSink>();
+    Log::GetInstance().Init(fullPath.c_str(), 16, 0);
+    Log::GetInstance().AddSink(fast, 0);
+    Log::GetInstance().AddSink(slow, 0, 2);
+    for (int i = 0; i < 2000; ++i)
+    {
+        LOG_INFO("fan out {}", i);
+        if (i % 100 == 0)
+            Log::GetInstance().Flush();
+    }
+    Log::GetInstance().Flush();
+    Log::GetInstance().RemoveSink(fast);
+    EXPECT_GT(Log::GetInstance().SinkDropped(slow), 0u);
+    slow->Release();
+    Log::GetInstance().RemoveSink(slow);
+    Log::GetInstance().Stop();
+
+    const std::string text = fast->Text();
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 2000);
+    EXPECT_NE(text.find("fan out 1999\n"), std::string::npos);
+    deleteFile(fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now()));
+}
+
+TEST(Log, UdpSinkPacksWholeLines)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = 0;
+    ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    UdpSink sink("127.0.0.1", ntohs(addr.sin_port), 64);
+    sink.Write("[I] | 2023-09-22:16:31 |first line\n[I] | 2023-09-22:16:31 |second line\n");
+    sink.Write(std::string(100, 'x') + "\n");
+
+    std::vector<std::string> received;
+    char buf[256];
+    ssize_t n;
+    while (received.size() < 4 && (n = recv(fd, buf, sizeof(buf), 0)) > 0)
+        received.emplace_back(buf, n);
+    close(fd);
+    ASSERT_EQ(received.size(), 4u);
+    EXPECT_EQ(received[0], "[I] | 2023-09-22:16:31 |first line\n");
+    EXPECT_EQ(received[1], "[I] | 2023-09-22:16:31 |second line\n");
+    EXPECT_EQ(received[2], std::string(64, 'x'));
+    EXPECT_EQ(received[3], std::string(36, 'x') + "\n");
+}
+
+TEST(Log, FormatSpecAppliesToCallSiteFormattedArguments)
+{
+    auto path = getcwd(NULL,0);
+    std::filesystem::path fullPath(path);
+    free(path);
+    fullPath.append("test/ts_log/spec_log");
+
+    const auto tp = std::chrono::system_clock::now();
+    Log::GetInstance().Init(fullPath.c_str(), 16, 0);
+    // time_point can't be recorded as a raw argument, the spec must still reach it
+    LOG_INFO("at {:%H:%M} done", tp);
+    LOG_INFO("plain {} and {:>6}", std::chrono::seconds(3), 42);
+    // float is recorded as float, not widened to double
+    LOG_INFO("float {} {:.3f} double {}", 0.1f, 2.5f, 0.1);
+    Log::GetInstance().Stop();
+
+    std::string f1 = fmt::format("{}_{:%Y-%m-%d}", fullPath.c_str(), std::chrono::system_clock::now());
+    std::ifstream in(f1);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_NE(text.find(fmt::format("at {:%H:%M} done\n", tp)), std::string::npos) << text;
+    EXPECT_NE(text.find("plain 3s and     42\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("float 0.1 2.500 double 0.1\n"), std::string::npos) << text;
+    EXPECT_EQ(text.find("format error"), std::string::npos) << text;
+    deleteFile(f1);
+}
+
 // [D] | 2023-09-22:16:31 |this log will not be recorded
 // [I] | 2023-09-22:16:31 |Start record from here
 // [W] | 2023-09-22:16:31 |Today is Fri